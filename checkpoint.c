@@ -0,0 +1,131 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Checkpoint files: the state of an LP at the beginning of an
+ *                      epoch, written by the LP and the model level (see
+ *                      t_graph.c and lunes.c) as a sequence of raw blocks,
+ *                      after a header that identifies the run (see checkpoint.h)
+ *                      and before a trailer (the magic again) that tells
+ *                      a complete file from a truncated one
+ *              -	The file is written with a temporary name and renamed
+ *                      when complete: a run that dies while writing leaves the
+ *                      previous checkpoints untouched
+ *              -	Any I/O error is fatal
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+
+/*! \brief Fatal I/O error on a checkpoint
+ */
+static void checkpoint_fail(checkpoint_t *ck, const char *what) {
+    fprintf(stdout, "FATAL ERROR, checkpoint %s: %s\n", ck->name, what);
+    fflush(stdout);
+    if (ck->writing) {
+        unlink(ck->tmp_name);
+    }
+    exit(-1);
+}
+
+/*! \brief Starts writing a checkpoint
+ */
+void checkpoint_create(checkpoint_t *ck, const char *name, const checkpoint_header *header) {
+    ck->writing = 1;
+    snprintf(ck->name, sizeof(ck->name), "%s", name);
+    snprintf(ck->tmp_name, sizeof(ck->tmp_name), "%s.%d.tmp", name, (int)getpid());
+
+    if ((ck->file = fopen(ck->tmp_name, "wb")) == NULL) {
+        checkpoint_fail(ck, "impossible to create the file");
+    }
+    checkpoint_put(ck, header, sizeof(checkpoint_header));
+}
+
+/*! \brief Opens a checkpoint for reading, its header has to match the expected one
+ */
+void checkpoint_open(checkpoint_t *ck, const char *name, const checkpoint_header *expected) {
+    checkpoint_header header;
+
+    ck->writing = 0;
+    snprintf(ck->name, sizeof(ck->name), "%s", name);
+
+    if ((ck->file = fopen(name, "rb")) == NULL) {
+        checkpoint_fail(ck, "impossible to open the file");
+    }
+    checkpoint_get(ck, &header, sizeof(checkpoint_header));
+
+    if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 || header.version != CHECKPOINT_VERSION) {
+        checkpoint_fail(ck, "not a checkpoint, or written by another version");
+    }
+    if (memcmp(&header, expected, sizeof(checkpoint_header)) != 0) {
+        fprintf(stdout, "FATAL ERROR, checkpoint %s: LP %d of %d, %d SEs each, step %d, MAX_TTL %d, LOOKUPS %d, CACHE_SIZE %d\n",
+                name, header.lp, header.lps, header.entities, header.step, header.max_ttl, header.lookups, header.cache_size);
+        fprintf(stdout, "FATAL ERROR, this run:   LP %d of %d, %d SEs each, step %d, MAX_TTL %d, LOOKUPS %d, CACHE_SIZE %d\n",
+                expected->lp, expected->lps, expected->entities, expected->step, expected->max_ttl, expected->lookups, expected->cache_size);
+        checkpoint_fail(ck, "it belongs to a different run");
+    }
+}
+
+/*! \brief Appends a block to the checkpoint
+ */
+void checkpoint_put(checkpoint_t *ck, const void *data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, ck->file) != size) {
+        checkpoint_fail(ck, "write error");
+    }
+}
+
+/*! \brief Reads the next block of the checkpoint
+ */
+void checkpoint_get(checkpoint_t *ck, void *data, size_t size) {
+    if (size > 0 && fread(data, 1, size, ck->file) != size) {
+        checkpoint_fail(ck, "truncated file");
+    }
+}
+
+/*! \brief Appends a GArray (number of elements, then the elements)
+ */
+void checkpoint_put_array(checkpoint_t *ck, GArray *array) {
+    uint32_t length = array->len;
+
+    checkpoint_put(ck, &length, sizeof(length));
+    checkpoint_put(ck, array->data, (size_t)length * g_array_get_element_size(array));
+}
+
+/*! \brief Reads a GArray written by checkpoint_put_array(), its content is replaced
+ */
+void checkpoint_get_array(checkpoint_t *ck, GArray *array) {
+    uint32_t length;
+
+    checkpoint_get(ck, &length, sizeof(length));
+    g_array_set_size(array, length);
+    checkpoint_get(ck, array->data, (size_t)length * g_array_get_element_size(array));
+}
+
+/*! \brief Completes the checkpoint: a written one gets its final name, all
+ *         of a read one has to be consumed
+ */
+void checkpoint_close(checkpoint_t *ck) {
+    char trailer[8];
+
+    if (ck->writing) {
+        checkpoint_put(ck, CHECKPOINT_MAGIC, sizeof(trailer));
+        if (fclose(ck->file) != 0 || rename(ck->tmp_name, ck->name) != 0) {
+            checkpoint_fail(ck, "write error");
+        }
+        return;
+    }
+
+    checkpoint_get(ck, trailer, sizeof(trailer));
+    if (memcmp(trailer, CHECKPOINT_MAGIC, sizeof(trailer)) != 0 || fgetc(ck->file) != EOF) {
+        checkpoint_fail(ck, "corrupted file");
+    }
+    fclose(ck->file);
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,61 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "checkpoint.c" description
+ *              -	Checkpoint file format
+ *              -	Function prototypes
+ *
+ ############################################################################################### */
+
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <glib.h>
+
+
+#define CHECKPOINT_MAGIC      "LUNESCKP"
+#define CHECKPOINT_VERSION    3
+
+/*! \brief Header of a checkpoint file: the run it belongs to, a checkpoint
+ *         can be restored only by a run with the same values
+ */
+typedef struct checkpoint_header {
+    char    magic[8];                       // CHECKPOINT_MAGIC
+    int32_t version;                        // CHECKPOINT_VERSION
+    int32_t lp;                             // LP that wrote it
+    int32_t lps;                            // Number of LPs
+    int32_t entities;                       // SEs of each LP
+    int32_t step;                           // Timestep (beginning of an epoch)
+    int32_t max_ttl;                        // Length of the epochs
+    int32_t lookups;                        // Concurrent lookups in each epoch
+    int32_t cache_size;                     // Messages in the cache of each node
+} checkpoint_header;
+
+/*! \brief A checkpoint being written (in a temporary file, renamed when it is
+ *         complete) or read
+ */
+typedef struct checkpoint_t {
+    FILE *file;
+    int   writing;
+    char  name[1024];
+    char  tmp_name[1024];
+} checkpoint_t;
+
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+void checkpoint_create(checkpoint_t *, const char *, const checkpoint_header *);
+void checkpoint_open(checkpoint_t *, const char *, const checkpoint_header *);
+void checkpoint_put(checkpoint_t *, const void *, size_t);
+void checkpoint_get(checkpoint_t *, void *, size_t);
+void checkpoint_put_array(checkpoint_t *, GArray *);
+void checkpoint_get_array(checkpoint_t *, GArray *);
+void checkpoint_close(checkpoint_t *);
+
+#endif /* __CHECKPOINT_H */
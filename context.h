@@ -0,0 +1,56 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Simulation context: all the state of a run (simulated time,
+ *                      directories of the SEs, random streams, lookups, local
+ *                      queue of the model events, statistics and the state of
+ *                      the model level). It is passed to all the handlers, the
+ *                      runtime configuration (env_*) is shared and read-only.
+ *                      An LP has a single context, the replicas of a run in a
+ *                      single process (see REPLICAS) have one each
+ *
+ ############################################################################################### */
+
+#ifndef __CONTEXT_H
+#define __CONTEXT_H
+
+#include <glib.h>
+#include "sim-parameters.h"
+#include "utils.h"
+#include "rng.h"
+
+
+struct lunes_model;                             // State of the model level (see lunes.c)
+
+typedef struct context_t {
+    int         replica;                        // Replica of the run (0 without REPLICAS)
+    double      simclock;                       // Simulated time
+    char        graph[1024];                    // Topology of the run ("" the default one, see lunes.c)
+
+    hash_t      hash_table, *table;             // Global hash table, contains ALL the simulated entities
+    hash_t      sim_table, *stable;             // Local hash table, contains only the locally managed entities
+    csr_t       adj_csr, *csr;                  // Adjacency snapshot (CSR) of the locally managed entities
+    rng_t       rng;                            // Counter-based random streams (see rng.c)
+
+    int *       applicant;                      // Applicant node of each lookup in the current epoch
+    int *       holder;                         // Holder node of each lookup in the current epoch
+
+    // Statistics
+    long        countMessages;
+    int         countEpochs;
+    int         countDelivers;
+    double      countSteps;
+
+    // Model events (see t_graph.c)
+    GArray *    events_queue[EVENTS_QUEUE_SIZE];        // Model events of each timestep (ring)
+    GByteArray *events_queue_data[EVENTS_QUEUE_SIZE];   // Their payloads
+    GArray *    events;                                 // Model events of the timestep being dispatched
+    GByteArray *events_data;                            // Their payloads
+    GArray *    events_groups;                          // First event of each receiver (in a phase)
+
+    struct lunes_model *model;
+} context_t;
+
+#endif /* __CONTEXT_H */
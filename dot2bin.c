@@ -0,0 +1,43 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Converts DOT graphs (e.g. generated by make-corpus) in
+ *                      the binary topology format used by the simulator
+ *                      (see topology.c): "graph.dot" -> "graph.dot.bin"
+ *
+ *              usage: ./dot2bin <graph.dot> [<graph.dot> ...]
+ *
+ *              the DOT files are parsed by one thread per core
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "topology.h"
+
+
+int main(int argc, char *argv[]) {
+    char bin_name[1024];
+    int  i, threads;
+
+    if (argc < 2) {
+        fprintf(stdout, "USAGE: %s <graph.dot> [<graph.dot> ...]\n", argv[0]);
+        exit(-1);
+    }
+
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (threads < 1) ? 1 : threads;
+
+    for (i = 1; i < argc; i++) {
+        snprintf(bin_name, sizeof(bin_name), "%s%s", argv[i], TOPOLOGY_SUFFIX);
+        if (topology_convert(argv[i], bin_name, threads) != 0) {
+            fprintf(stdout, "FATAL ERROR, impossible to write the binary topology: %s\n", bin_name);
+            exit(-1);
+        }
+    }
+
+    return(0);
+}
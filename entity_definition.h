@@ -19,11 +19,16 @@
 
 /*---- E N T I T I E S    D E F I N I T I O N ---------------------------------*/
 
+struct hash_node_t;
+
 /*! \brief Structure of "value" in the hash table of each node
  *         in LUNES used to implement neighbors and its properties
+ *         NOTE: the handle is resolved once, when the link is created, and it
+ *         is valid only in the local LP (it is resolved again after a migration)
  */
 typedef struct v_e {
-    unsigned int value;                     // Value
+    unsigned int        value;              // Value
+    struct hash_node_t *node;               // Handle of the neighbor in the global hash table
 } value_element;
 
 /*! \brief Records composing the local state (dynamic part) of each SE
@@ -34,16 +39,31 @@ struct state_element {
     value_element elements; // Value
 };
 
-/*! \brief SE state definition */
+/*! \brief Neighbors of a SE (local state, dynamic part), stored as a row of the
+ *         CSR adjacency snapshot. When the neighborhood changes between two folds
+ *         the row is copied in a private overlay, see csr_fold() in utils.c
+ *         The index maps each key to its position, so that insertions, deletions
+ *         (swap with the last record), membership tests and uniform sampling are O(1)
+ *         NOTE: no duplicated keys are allowed
+ */
+typedef struct adj_row {
+    struct state_element *record;   // Neighbors, contiguous records
+    unsigned int          count;    // Number of neighbors in the row
+    unsigned int          capacity; // Number of allocated records
+    unsigned char         overlay;  // 1 if record is a private overlay, 0 if it is in the snapshot
+    GHashTable *          index;    // Key -> position in the row + 1 (glib, direct hashing)
+} adj_row;
+
+/*! \brief SE state definition
+ *         NOTE: the fields accessed at each timestep (status and number of
+ *         neighbors) are not here, they are stored as arrays in the global
+ *         directory (struct-of-arrays), see SE_STATUS() in utils.h
+ */
 typedef struct hash_data_t {
     int           key;                    // SE identifier
     int           lp;                     // Logical Process ID (that is the SE container)
     int           internal_timer;         // Used to track mining activity
-    int	      	  status;	    // 0 off 1 active 2 applicant 3 holder 5 active and received the message 4 holder and received the message
-    GHashTable *  state;                  // Local state as an hash table (glib) (dynamic part)
-    int		  received;	    // 0 not received anything, !=0 received the message, -1 received the message back in the fluff phase
-    unsigned int  num_neighbors;           // Number of SE's neighbors (dynamically updated)
-    //#endif
+    adj_row       neighbors;              // Local state (dynamic part): neighbors, as a row of the CSR adjacency snapshot
 } hash_data_t;
 
 #endif /* __ENTITY_DEFINITION_H */
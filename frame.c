@@ -0,0 +1,165 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Aggregation of the model messages: the messages directed
+ *                      to SEs of the same LP (with the same timestamp) are
+ *                      packed in a frame, that is a single GAIA message.
+ *                      The frames are sent when full or at the end of the
+ *                      timestep and unpacked by the receiving LP
+ *              -	The messages directed to SEs of the local LP do not go
+ *                      through GAIA: they are passed (by reference, copied once)
+ *                      to the local queue of the model events
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <gaia.h>
+#include "utils.h"
+#include "msg_definition.h"
+#include "context.h"
+#include "frame.h"
+
+
+/* ************************************************************************ */
+/*       L O C A L	V A R I A B L E S			                            */
+/* ************************************************************************ */
+
+static GByteArray **frame_buffer;       // The frame under construction for each destination LP
+static double *     frame_ts;           // Its timestamp
+static int *        frame_from;         // Sender of the frame (the sender of its first record)
+static int *        frame_to;           // Receiver of the frame (an SE of the destination LP)
+static int          frame_lps;          // Number of LPs
+static int          frame_enabled;      // False: each model message is sent by itself
+static int          frame_lp;           // The local LP
+static void (*frame_local)(context_t *, int, int, double, Msg *, int);  // Local delivery of a model message
+
+
+/*! \brief Allocates a frame for each LP
+ *  @param[in] lp_local: the local LP
+ *  @param[in] enabled: false when GAIA needs to see each interaction (e.g. migration is on)
+ *  @param[in] local: local(ctx, from, to, ts, msg, size) enqueues a message to a local SE
+ */
+void frame_init(int lps, int lp_local, int enabled, void (*local)(context_t *, int, int, double, Msg *, int)) {
+    int lp;
+
+    frame_lps     = lps;
+    frame_lp      = lp_local;
+    frame_enabled = enabled;
+    frame_local   = local;
+    frame_buffer  = (GByteArray **)malloc(sizeof(GByteArray *) * lps);
+    frame_ts      = (double *)malloc(sizeof(double) * lps);
+    frame_from    = (int *)malloc(sizeof(int) * lps);
+    frame_to      = (int *)malloc(sizeof(int) * lps);
+    ASSERT((frame_buffer != NULL && frame_ts != NULL && frame_from != NULL && frame_to != NULL), ("frame_init: malloc error"));
+
+    for (lp = 0; lp < lps; lp++) {
+        frame_buffer[lp] = g_byte_array_sized_new(FRAME_SIZE);
+    }
+}
+
+/*! \brief Sends the frame of an LP (if not empty)
+ */
+static void frame_emit(int lp) {
+    GByteArray *frame = frame_buffer[lp];
+
+    if (frame->len == 0) {
+        return;
+    }
+
+    GAIA_Send(frame_from[lp], frame_to[lp], frame_ts[lp], (void *)frame->data, frame->len);
+    g_byte_array_set_size(frame, 0);
+}
+
+/*! \brief Appends a model message to the frame of the LP of its receiver
+ */
+void frame_send(context_t *ctx, int from, int to, double ts, void *msg, unsigned int size) {
+    struct _frame_record       record;
+    struct _frame_static_part *header;
+    hash_node_t *              node;
+    GByteArray *               frame;
+    unsigned int               needed = FRAME_RECORD + MSG_PADDED(size);
+    guint                      position;
+    int                        lp;
+
+    if (!frame_enabled) {
+        GAIA_Send(from, to, ts, msg, size);
+        return;
+    }
+
+    if (!(node = hash_lookup(ctx->table, to)) || node->data->lp < 0 || node->data->lp >= frame_lps) {
+        fprintf(stdout, "%12.2f FATAL ERROR, [%5d] is an unknown destination, impossible to frame the message\n", ctx->simclock, to);
+        fflush(stdout);
+        exit(-1);
+    }
+    lp = node->data->lp;
+
+    // Local receiver, GAIA is not involved
+    if (lp == frame_lp) {
+        frame_local(ctx, from, to, ts, (Msg *)msg, size);
+        return;
+    }
+
+    ASSERT((FRAME_HEADER + needed <= FRAME_SIZE), ("frame_send: message of %u bytes larger than a frame", size));
+    frame = frame_buffer[lp];
+
+    // The frames have a single timestamp and a bounded size
+    if (frame->len > 0 && (frame_ts[lp] != ts || frame->len + needed > FRAME_SIZE)) {
+        frame_emit(lp);
+    }
+
+    if (frame->len == 0) {
+        g_byte_array_set_size(frame, FRAME_HEADER);
+        memset(frame->data, 0, FRAME_HEADER);
+        header          = (struct _frame_static_part *)frame->data;
+        header->type    = 'F';
+        header->records = 0;
+        frame_ts[lp]    = ts;
+        frame_from[lp]  = from;
+        frame_to[lp]    = to;
+    }
+
+    record.from = from;
+    record.to   = to;
+    record.size = size;
+
+    position = frame->len;
+    g_byte_array_set_size(frame, position + needed);
+    memcpy(frame->data + position, &record, sizeof(struct _frame_record));
+    memcpy(frame->data + position + FRAME_RECORD, msg, size);
+
+    ((struct _frame_static_part *)frame->data)->records++;
+}
+
+/*! \brief Sends all the pending frames, called at the end of each timestep
+ */
+void frame_flush() {
+    int lp;
+
+    for (lp = 0; lp < frame_lps; lp++) {
+        frame_emit(lp);
+    }
+}
+
+/*! \brief Unpacks a received frame, deliver(ctx, from, to, msg, size) is called
+ *         for each model message in it
+ */
+void frame_unpack(context_t *ctx, Msg *frame, int size, void (*deliver)(context_t *, int, int, Msg *, int)) {
+    struct _frame_record *record;
+    unsigned int          i;
+    int                   position = FRAME_HEADER;
+
+    for (i = 0; i < frame->frame.frame_static.records; i++) {
+        record = (struct _frame_record *)((char *)frame + position);
+        ASSERT((position + (int)FRAME_RECORD + (int)record->size <= size), ("frame_unpack: truncated frame"));
+
+        deliver(ctx, record->from, record->to, (Msg *)((char *)record + FRAME_RECORD), record->size);
+        position += FRAME_RECORD + MSG_PADDED(record->size);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
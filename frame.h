@@ -0,0 +1,26 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "frame.c" description
+ *              -	Function prototypes
+ *
+ ############################################################################################### */
+
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#include "msg_definition.h"
+#include "context.h"
+
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+void frame_init(int, int, int, void (*)(context_t *, int, int, double, Msg *, int));
+void frame_send(context_t *, int, int, double, void *, unsigned int);
+void frame_flush();
+void frame_unpack(context_t *, Msg *, int, void (*)(context_t *, int, int, Msg *, int));
+
+#endif /* __FRAME_H */
@@ -9,82 +9,955 @@
  *              This an external tool used to build graphs that will be used
  *              in the simulator.
  *
+ *              -	Models: Barabási–Albert (preferential attachment, with
+ *                      the power of the degree), Watts–Strogatz (ring lattice
+ *                      with rewiring), Erdős–Rényi G(n, m) and random k-regular.
+ *                      All of them have (about) <#edges> edges and no loops or
+ *                      multiple edges
+ *              -	The random numbers are drawn from a generator with an
+ *                      explicit seed: the same seed gives the same graph
+ *              -	The graph is kept as an array of edges (memory linear in
+ *                      the edges), it is generated again (next attempt of the
+ *                      seed) until it is connected and its diameter is within
+ *                      <max_diameter>. It is streamed to the DOT file and, on
+ *                      request, to its binary topology (see topology.c)
+ *              -	A corpus of graphs (-n) is generated by a pool of threads,
+ *                      each graph with its own seed: the graphs do not depend on
+ *                      the number of threads. The properties of all the graphs
+ *                      (connectivity, diameter, degrees) are written in a tab
+ *                      separated summary file
+ *              -	The connectivity is checked by a single breadth-first
+ *                      search. The diameter is bounded by iFUB, within a budget
+ *                      of visited edges (usually it is exact after a few searches),
+ *                      the searches go on after the budget until the bounds tell
+ *                      whether the diameter is within <max_diameter>. The exact
+ *                      diameter (a search from each node, O(V*E)) is computed on
+ *                      request
+ *
  *      Authors:
  *              First version by Gabriele D'Angelo <g.dangelo@unibo.it>
  *
- ###############################################################################################
- #
- #      TODO:
- #
- #              -	Almost everything :-(
- #
- */
+ ############################################################################################### */
 
-#include <igraph/igraph.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include "topology.h"
+
+
+#define GRAPHGEN_ATTEMPTS       100         // Graphs generated for a seed before giving up
+#define GRAPHGEN_BA_POWER       1.6         // Barabási–Albert: power of the degree in the attachment probability
+#define GRAPHGEN_BA_ZERO        1.0         // Barabási–Albert: attractiveness of the nodes without edges
+#define GRAPHGEN_WS_PROB        0.1         // Watts–Strogatz: rewiring probability of each edge
+#define GRAPHGEN_PAIRING_FAILS  1000        // k-regular: failed pairings in a row before restarting
+#define GRAPHGEN_IFUB_WORK      4e8         // Diameter: nodes and edges visited by iFUB before giving up the exact value
+#define GRAPHGEN_IFUB_MIN       8           // Diameter: breadth-first searches of iFUB, at least
+#define GRAPHGEN_WRITE_BUFFER   (1 << 20)   // Output buffer of the DOT file
+
+#ifndef MIN
+#define MIN(a, b)    (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)    (((a) > (b)) ? (a) : (b))
+#endif
+
+#define EDGE_EMPTY              0           // Free slot of the edge set
+#define EDGE_DELETED            UINT64_MAX  // Removed edge of the edge set
+
+/*! \brief Graph models
+ */
+typedef enum graph_model {
+    MODEL_BA,                               // Barabási–Albert
+    MODEL_WS,                               // Watts–Strogatz
+    MODEL_ER,                               // Erdős–Rényi G(n, m)
+    MODEL_REGULAR                           // Random k-regular
+} graph_model;
+
+/*! \brief Random numbers generator (xoshiro256**), the state is explicit
+ */
+typedef struct graph_rng {
+    uint64_t s[4];
+} graph_rng;
+
+/*! \brief A generated graph: its edges, in order of generation
+ */
+typedef struct graph_t {
+    uint32_t       nodes;
+    uint64_t       edges;
+    uint64_t       capacity;
+    topology_edge *edge;
+} graph_t;
+
+/*! \brief Set of undirected edges (open addressing), to reject multiple edges
+ */
+typedef struct edge_set {
+    uint64_t *key;
+    uint64_t  mask;
+    int       shift;                        // 64 - log2(size), the slot is taken from the high bits of the hash
+} edge_set;
+
+/*! \brief Parameters of the graphs, the same for all the corpus
+ */
+typedef struct graph_config {
+    graph_model model;
+    uint32_t    nodes;
+    uint64_t    edges;
+    uint32_t    edges_per_node;
+    uint32_t    max_diameter;
+    int         count;                      // Graphs in the corpus
+    int         binary;                     // The binary topology is written too
+    int         exact;                      // Exact diameter
+} graph_config;
+
+/*! \brief A graph of the corpus: its seed and output file, then its properties
+ */
+typedef struct graph_summary {
+    int      number;                        // From 1
+    uint64_t seed;
+    char     name[1024];
+    uint64_t edges;
+    int      connected;
+    uint32_t diameter;                      // Exact or lower bound
+    uint32_t upper;                         // Upper bound of the diameter
+    uint32_t degree_min;
+    uint32_t degree_max;
+    double   degree_mean;
+    int      attempts;                      // Graphs generated for the seed
+    int      failed;
+} graph_summary;
+
+
+/* ************************************************************************ */
+/*       L O C A L	V A R I A B L E S			                            */
+/* ************************************************************************ */
+
+static graph_config    config;
+static graph_summary * corpus;                                   // The graphs, in order
+static int             corpus_next;                              // First graph not yet handed out
+static pthread_mutex_t corpus_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 void print_usage() {
     fprintf(stdout, "Syntax error:\n");
-    fprintf(stdout, "\tUSAGE: graphgen <#nodes> <#edges> <output_file_name> <max_diameter>\n");
+    fprintf(stdout, "\tUSAGE: graphgen [-m ba|ws|er|regular] [-s <seed>] [-n <#graphs>] [-t <#threads>] [-o <summary_file>] [-b] [-x] <#nodes> <#edges> <output_file_name> <max_diameter>\n");
     fprintf(stdout, "\t<#edges> / <#nodes> > 0\n");
+    fprintf(stdout, "\t-m: model of the graph (default: ba)\n");
+    fprintf(stdout, "\t-s: seed of the random numbers, the graph number g (from 1) uses seed + g - 1 (default: 1)\n");
+    fprintf(stdout, "\t-n: graphs in the corpus, <output_file_name> must contain a \"%%d\" (number of the graph) (default: 1)\n");
+    fprintf(stdout, "\t-t: graphs generated in parallel (default: one for each core)\n");
+    fprintf(stdout, "\t-o: summary of the graphs, tab separated (default: status.txt)\n");
+    fprintf(stdout, "\t-b: the binary topology is written too (<output_file_name>%s)\n", TOPOLOGY_SUFFIX);
+    fprintf(stdout, "\t-x: exact diameter (slow on large graphs), instead of its bounds\n");
     fflush(stdout);
     exit(-1);
 }
 
+/* ************************************************************************ */
+/*                      Random numbers                                      */
+/* ************************************************************************ */
+
+static uint64_t graph_splitmix(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return(z ^ (z >> 31));
+}
+
+/*! \brief The state depends on the seed and on the attempt
+ */
+static void graph_rng_init(graph_rng *rng, uint64_t seed, uint64_t attempt) {
+    uint64_t x = seed ^ (attempt * 0xD1B54A32D192ED03ULL);
+    int      i;
+
+    for (i = 0; i < 4; i++) {
+        rng->s[i] = graph_splitmix(&x);
+    }
+}
+
+static inline uint64_t graph_rng_next(graph_rng *rng) {
+    uint64_t *s      = rng->s;
+    uint64_t  result = s[1] * 5;
+    uint64_t  t      = s[1] << 17;
+
+    result = ((result << 7) | (result >> 57)) * 9;
+    s[2]  ^= s[0];
+    s[3]  ^= s[1];
+    s[1]  ^= s[2];
+    s[0]  ^= s[3];
+    s[2]  ^= t;
+    s[3]   = (s[3] << 45) | (s[3] >> 19);
+    return(result);
+}
+
+/*! \brief Uniform in [0, 1)
+ */
+static inline double graph_rng_unit(graph_rng *rng) {
+    return((graph_rng_next(rng) >> 11) * (1.0 / 9007199254740992.0));
+}
+
+/*! \brief Uniform integer in [0, n)
+ */
+static inline uint32_t graph_rng_below(graph_rng *rng, uint64_t n) {
+    return((uint32_t)(((unsigned __int128)graph_rng_next(rng) * n) >> 64));
+}
+
+/* ************************************************************************ */
+/*                      Edges                                               */
+/* ************************************************************************ */
+
+static void graph_add(graph_t *graph, uint32_t source, uint32_t destination) {
+    if (graph->edges == graph->capacity) {
+        graph->capacity = graph->capacity ? graph->capacity * 2 : 1024;
+        graph->edge     = (topology_edge *)realloc(graph->edge, graph->capacity * sizeof(topology_edge));
+        if (graph->edge == NULL) {
+            fprintf(stdout, "FATAL ERROR, graph_add: malloc error\n");
+            exit(-1);
+        }
+    }
+    graph->edge[graph->edges].source      = source;
+    graph->edge[graph->edges].destination = destination;
+    graph->edges++;
+}
+
+/*! \brief Empty set for about "edges" edges (load factor below 1/2)
+ */
+static void edge_set_init(edge_set *set, uint64_t edges) {
+    uint64_t size = 16;
+
+    set->shift = 60;
+    while (size < 2 * edges) {
+        size *= 2;
+        set->shift--;
+    }
+    set->mask = size - 1;
+    set->key  = (uint64_t *)calloc(size, sizeof(uint64_t));
+    if (set->key == NULL) {
+        fprintf(stdout, "FATAL ERROR, edge_set_init: malloc error\n");
+        exit(-1);
+    }
+}
+
+static inline uint64_t edge_key(uint32_t a, uint32_t b) {
+    return((a < b) ? (((uint64_t)a << 32) | b) + 1 : (((uint64_t)b << 32) | a) + 1);
+}
+
+/*! \brief Slot of the edge, or of the free slot where it can be inserted
+ */
+static uint64_t edge_set_slot(edge_set *set, uint64_t key) {
+    uint64_t slot    = (key * 0x9E3779B97F4A7C15ULL) >> set->shift;
+    uint64_t deleted = UINT64_MAX;
+
+    while (set->key[slot] != EDGE_EMPTY && set->key[slot] != key) {
+        if (set->key[slot] == EDGE_DELETED && deleted == UINT64_MAX) {
+            deleted = slot;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    return((set->key[slot] == EDGE_EMPTY && deleted != UINT64_MAX) ? deleted : slot);
+}
+
+/*! \brief Inserts an edge, 0 if it is already in the set
+ */
+static int edge_set_insert(edge_set *set, uint32_t a, uint32_t b) {
+    uint64_t key  = edge_key(a, b);
+    uint64_t slot = edge_set_slot(set, key);
+
+    if (set->key[slot] == key) {
+        return(0);
+    }
+    set->key[slot] = key;
+    return(1);
+}
+
+static void edge_set_delete(edge_set *set, uint32_t a, uint32_t b) {
+    uint64_t key  = edge_key(a, b);
+    uint64_t slot = edge_set_slot(set, key);
+
+    if (set->key[slot] == key) {
+        set->key[slot] = EDGE_DELETED;
+    }
+}
+
+/* ************************************************************************ */
+/*                      Models                                              */
+/* ************************************************************************ */
+
+/*! \brief Fenwick tree: adds "delta" to the weight of a node
+ */
+static void fenwick_add(double *tree, uint32_t nodes, uint32_t node, double delta) {
+    uint64_t i;
+
+    for (i = (uint64_t)node + 1; i <= nodes; i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+static double fenwick_total(double *tree, uint32_t nodes) {
+    double   total = 0;
+    uint64_t i;
+
+    for (i = nodes; i > 0; i -= i & -i) {
+        total += tree[i];
+    }
+    return(total);
+}
+
+/*! \brief Node where the cumulative weight exceeds "target"
+ */
+static uint32_t fenwick_find(double *tree, uint32_t nodes, double target) {
+    uint64_t position = 0, step = 1;
+
+    while (step * 2 <= nodes) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (position + step <= nodes && tree[position + step] <= target) {
+            position += step;
+            target   -= tree[position];
+        }
+    }
+    return((uint32_t)position);
+}
+
+/*! \brief Barabási–Albert: each new node is linked to "m" distinct older nodes,
+ *         chosen with probability proportional to degree^power + zero
+ */
+static int generate_ba(graph_t *graph, graph_rng *rng, uint32_t m, double power, double zero) {
+    uint32_t  nodes  = graph->nodes;
+    double *  tree   = (double *)calloc((size_t)nodes + 1, sizeof(double));
+    double *  weight = (double *)calloc(nodes, sizeof(double));
+    uint32_t *degree = (uint32_t *)calloc(nodes, sizeof(uint32_t));
+    uint32_t  target[m];
+    uint32_t  v, u, k, i;
+
+    if (tree == NULL || weight == NULL || degree == NULL) {
+        fprintf(stdout, "FATAL ERROR, generate_ba: malloc error\n");
+        exit(-1);
+    }
+
+    weight[0] = zero;
+    fenwick_add(tree, nodes, 0, weight[0]);
+
+    for (v = 1; v < nodes; v++) {
+        k = (v < m) ? v : m;
+
+        // Without replacement: a chosen node has no weight until the end of the draws
+        for (i = 0; i < k; i++) {
+            do {
+                u = fenwick_find(tree, nodes, graph_rng_unit(rng) * fenwick_total(tree, v));
+            } while (u >= v || weight[u] == 0);
+            target[i] = u;
+            fenwick_add(tree, nodes, u, -weight[u]);
+            weight[u] = 0;
+        }
+
+        for (i = 0; i < k; i++) {
+            u = target[i];
+            graph_add(graph, v, u);
+            degree[u]++;
+            weight[u] = ((power == 1.0) ? degree[u] : pow(degree[u], power)) + zero;
+            fenwick_add(tree, nodes, u, weight[u]);
+        }
+        degree[v] = k;
+        weight[v] = ((power == 1.0) ? k : pow(k, power)) + zero;
+        fenwick_add(tree, nodes, v, weight[v]);
+    }
+
+    free(tree);
+    free(weight);
+    free(degree);
+    return(0);
+}
+
+/*! \brief Watts–Strogatz: ring lattice (each node linked to its "k" following
+ *         nodes), each edge is rewired with probability "p" to a random node
+ */
+static int generate_ws(graph_t *graph, graph_rng *rng, uint32_t k, double p) {
+    uint32_t nodes = graph->nodes;
+    edge_set set;
+    uint64_t e;
+    uint32_t u, v, w;
+
+    edge_set_init(&set, (uint64_t)nodes * k);
+    for (u = 0; u < nodes; u++) {
+        for (v = 1; v <= k; v++) {
+            edge_set_insert(&set, u, (u + v) % nodes);
+            graph_add(graph, u, (u + v) % nodes);
+        }
+    }
+
+    for (e = 0; e < graph->edges; e++) {
+        if (graph_rng_unit(rng) >= p) {
+            continue;
+        }
+        u = graph->edge[e].source;
+        do {
+            w = graph_rng_below(rng, nodes);
+        } while (w == u || !edge_set_insert(&set, u, w));
+        edge_set_delete(&set, u, graph->edge[e].destination);
+        graph->edge[e].destination = w;
+    }
+
+    free(set.key);
+    return(0);
+}
+
+/*! \brief Erdős–Rényi G(n, m): "m" distinct edges, uniformly at random
+ */
+static int generate_er(graph_t *graph, graph_rng *rng, uint64_t m) {
+    uint32_t nodes = graph->nodes;
+    edge_set set;
+    uint32_t u, v;
+
+    edge_set_init(&set, m);
+    while (graph->edges < m) {
+        u = graph_rng_below(rng, nodes);
+        v = graph_rng_below(rng, nodes);
+        if (u != v && edge_set_insert(&set, u, v)) {
+            graph_add(graph, u, v);
+        }
+    }
+
+    free(set.key);
+    return(0);
+}
+
+/*! \brief Random k-regular: the "stubs" of the nodes are paired at random, a
+ *         pair that gives a loop or a multiple edge is drawn again. It fails
+ *         (-1) when the remaining stubs can not be paired
+ */
+static int generate_regular(graph_t *graph, graph_rng *rng, uint32_t k) {
+    uint64_t  stubs = (uint64_t)graph->nodes * k;
+    uint32_t *stub  = (uint32_t *)malloc(stubs * sizeof(uint32_t));
+    edge_set  set;
+    uint64_t  i, j, t, fails = 0;
+    uint32_t  a, b;
+
+    if (stub == NULL) {
+        fprintf(stdout, "FATAL ERROR, generate_regular: malloc error\n");
+        exit(-1);
+    }
+    for (i = 0; i < stubs; i++) {
+        stub[i] = (uint32_t)(i / k);
+    }
+
+    edge_set_init(&set, stubs / 2);
+    while (stubs > 0 && fails < GRAPHGEN_PAIRING_FAILS) {
+        i = graph_rng_below(rng, stubs);
+        j = graph_rng_below(rng, stubs);
+        a = stub[i];
+        b = stub[j];
+        if (a == b || !edge_set_insert(&set, a, b)) {
+            fails++;
+            continue;
+        }
+        graph_add(graph, a, b);
+        fails = 0;
+
+        // The two stubs are replaced by the last ones
+        if (i < j) {
+            t = i;
+            i = j;
+            j = t;
+        }
+        stub[i] = stub[--stubs];
+        stub[j] = stub[--stubs];
+    }
+
+    free(stub);
+    free(set.key);
+    return((stubs == 0) ? 0 : -1);
+}
+
+/* ************************************************************************ */
+/*                      Connectivity and diameter                           */
+/* ************************************************************************ */
+
+/*! \brief Adjacency lists (CSR) of the graph
+ */
+static void graph_adjacency(graph_t *graph, uint64_t **offset, uint32_t **adjacent) {
+    uint64_t *position;
+    uint64_t  e;
+    uint32_t  v;
+
+    *offset   = (uint64_t *)calloc((size_t)graph->nodes + 1, sizeof(uint64_t));
+    *adjacent = (uint32_t *)malloc(2 * graph->edges * sizeof(uint32_t) + 1);
+    position  = (uint64_t *)malloc(((size_t)graph->nodes + 1) * sizeof(uint64_t));
+    if (*offset == NULL || *adjacent == NULL || position == NULL) {
+        fprintf(stdout, "FATAL ERROR, graph_adjacency: malloc error\n");
+        exit(-1);
+    }
+
+    for (e = 0; e < graph->edges; e++) {
+        (*offset)[graph->edge[e].source + 1]++;
+        (*offset)[graph->edge[e].destination + 1]++;
+    }
+    for (v = 0; v < graph->nodes; v++) {
+        (*offset)[v + 1] += (*offset)[v];
+    }
+    memcpy(position, *offset, ((size_t)graph->nodes + 1) * sizeof(uint64_t));
+    for (e = 0; e < graph->edges; e++) {
+        (*adjacent)[position[graph->edge[e].source]++]      = graph->edge[e].destination;
+        (*adjacent)[position[graph->edge[e].destination]++] = graph->edge[e].source;
+    }
+    free(position);
+}
+
+/*! \brief Breadth-first search from "source": eccentricity of the source, the
+ *         number of reached nodes is returned in "reached"
+ */
+static uint32_t graph_bfs(uint32_t nodes, uint64_t *offset, uint32_t *adjacent, uint32_t source,
+                          uint32_t *distance, uint32_t *queue, uint32_t *reached) {
+    uint32_t head = 0, tail = 0, v, w;
+    uint64_t a;
+
+    memset(distance, 0xFF, (size_t)nodes * sizeof(uint32_t));
+    distance[source] = 0;
+    queue[tail++]    = source;
+    while (head < tail) {
+        v = queue[head++];
+        for (a = offset[v]; a < offset[v + 1]; a++) {
+            w = adjacent[a];
+            if (distance[w] == UINT32_MAX) {
+                distance[w]   = distance[v] + 1;
+                queue[tail++] = w;
+            }
+        }
+    }
+    *reached = tail;
+    return(distance[queue[tail - 1]]);
+}
+
+// iFUB goes on within the budget, or after it while the diameter could be both within and over the limit
+#define GRAPH_IFUB_GO_ON(_searches, _budget, _limit, _lower, _upper)    ((_searches) < (_budget) || ((_lower) <= (_limit) && (_upper) > (_limit)))
+
+/*! \brief Diameter of a connected graph, iFUB: the nodes are visited from the
+ *         farthest of a root (the node with the largest degree), a level at a
+ *         time, until the bounds meet. The lower bound starts from a double
+ *         sweep. At most "budget" searches, unless the bounds do not tell yet
+ *         whether the diameter is within "limit": the result is "lower" (exact
+ *         if it is equal to "upper")
+ */
+static void graph_ifub(uint32_t nodes, uint64_t *offset, uint32_t *adjacent, uint32_t *distance, uint32_t *queue,
+                       uint32_t budget, uint32_t limit, uint32_t *lower, uint32_t *upper) {
+    uint32_t *level, *order;
+    uint32_t  root = 0, v, i, first, last, eccentricity, reached, searches = 0;
+
+    for (v = 1; v < nodes; v++) {
+        root = (offset[v + 1] - offset[v] > offset[root + 1] - offset[root]) ? v : root;
+    }
+
+    // The nodes by distance from the root
+    level = (uint32_t *)malloc((size_t)nodes * sizeof(uint32_t));
+    order = (uint32_t *)malloc((size_t)nodes * sizeof(uint32_t));
+    if (level == NULL || order == NULL) {
+        fprintf(stdout, "FATAL ERROR, graph_ifub: malloc error\n");
+        exit(-1);
+    }
+    eccentricity = graph_bfs(nodes, offset, adjacent, root, distance, queue, &reached);
+    searches++;
+    memcpy(level, distance, (size_t)nodes * sizeof(uint32_t));
+    memcpy(order, queue, (size_t)nodes * sizeof(uint32_t));
+    *upper = 2 * eccentricity;
+
+    // Double sweep: eccentricity of the farthest node from the root
+    *lower = graph_bfs(nodes, offset, adjacent, order[nodes - 1], distance, queue, &reached);
+    searches++;
+
+    // Level "i": the pairs of nodes not yet checked are within 2 * i
+    last = nodes;
+    for (i = eccentricity; i > 0 && *lower < *upper && GRAPH_IFUB_GO_ON(searches, budget, limit, *lower, *upper); i--) {
+        for (first = last; first > 0 && level[order[first - 1]] == i; first--) {
+        }
+        for (v = first; v < last && GRAPH_IFUB_GO_ON(searches, budget, limit, *lower, *upper); v++, searches++) {
+            eccentricity = graph_bfs(nodes, offset, adjacent, order[v], distance, queue, &reached);
+            *lower       = (eccentricity > *lower) ? eccentricity : *lower;
+        }
+        if (v < last) {
+            break;                                      // Budget exhausted (and within or over the limit) inside the level
+        }
+        if (*lower > 2 * (i - 1)) {
+            *upper = *lower;
+        }else {
+            *upper = 2 * (i - 1);
+        }
+        last = first;
+    }
+    *upper = (*upper < *lower) ? *lower : *upper;
+
+    free(level);
+    free(order);
+}
+
+/*! \brief Connectivity of the graph (1 connected, a breadth-first search) and,
+ *         if connected, its diameter: the bounds of iFUB (see graph_ifub), that
+ *         always tell whether it is within "limit", or, if "exact", a
+ *         breadth-first search from each node. The degrees are summarized too
+ */
+static int graph_check(graph_t *graph, int exact, uint32_t limit, graph_summary *summary) {
+    uint64_t *offset;
+    uint32_t *adjacent, *distance, *queue;
+    uint32_t  v, reached, eccentricity, searches, degree;
+
+    graph_adjacency(graph, &offset, &adjacent);
+    distance = (uint32_t *)malloc((size_t)graph->nodes * sizeof(uint32_t));
+    queue    = (uint32_t *)malloc((size_t)graph->nodes * sizeof(uint32_t));
+    if (distance == NULL || queue == NULL) {
+        fprintf(stdout, "FATAL ERROR, graph_check: malloc error\n");
+        exit(-1);
+    }
+
+    summary->edges      = graph->edges;
+    summary->degree_min = UINT32_MAX;
+    summary->degree_max = 0;
+    for (v = 0; v < graph->nodes; v++) {
+        degree              = (uint32_t)(offset[v + 1] - offset[v]);
+        summary->degree_min = MIN(summary->degree_min, degree);
+        summary->degree_max = MAX(summary->degree_max, degree);
+    }
+    summary->degree_mean = 2.0 * graph->edges / graph->nodes;
+
+    summary->diameter  = graph_bfs(graph->nodes, offset, adjacent, 0, distance, queue, &reached);
+    summary->connected = (reached == graph->nodes);
+    if (summary->connected && !exact) {
+        searches = (uint32_t)MIN(GRAPHGEN_IFUB_WORK / (graph->nodes + 2.0 * graph->edges), UINT32_MAX);
+        graph_ifub(graph->nodes, offset, adjacent, distance, queue, MAX(searches, GRAPHGEN_IFUB_MIN), limit,
+                   &summary->diameter, &summary->upper);
+    }else {
+        for (v = 1; summary->connected && v < graph->nodes; v++) {
+            eccentricity      = graph_bfs(graph->nodes, offset, adjacent, v, distance, queue, &reached);
+            summary->diameter = MAX(summary->diameter, eccentricity);
+        }
+        summary->upper = summary->diameter;
+    }
+
+    free(offset);
+    free(adjacent);
+    free(distance);
+    free(queue);
+    return(summary->connected);
+}
+
+/* ************************************************************************ */
+/*                      Output                                              */
+/* ************************************************************************ */
+
+/*! \brief Appends an unsigned integer in decimal notation, returns the new end
+ */
+static inline char *graph_format(char *p, uint32_t value) {
+    char  digits[10];
+    int   n = 0;
+
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value      /= 10;
+    } while (value > 0);
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return(p);
+}
+
+/*! \brief Streams the edges to a DOT file ("A -- B;" lines), 0 on success
+ */
+static int graph_write_dot(graph_t *graph, const char *dot_name) {
+    FILE *   dot_file;
+    char *   buffer, *p;
+    uint64_t e;
+    int      ret = 0;
+
+    if ((dot_file = fopen(dot_name, "w")) == NULL) {
+        return(-1);
+    }
+    if ((buffer = (char *)malloc(GRAPHGEN_WRITE_BUFFER)) == NULL) {
+        fprintf(stdout, "FATAL ERROR, graph_write_dot: malloc error\n");
+        exit(-1);
+    }
+
+    fprintf(dot_file, "/* Created by graphgen */\ngraph {\n");
+    p = buffer;
+    for (e = 0; e < graph->edges; e++) {
+        // Room for the longest line
+        if (p - buffer > GRAPHGEN_WRITE_BUFFER - 32) {
+            ret |= (fwrite(buffer, 1, p - buffer, dot_file) != (size_t)(p - buffer));
+            p    = buffer;
+        }
+        *p++ = '\t';
+        p    = graph_format(p, graph->edge[e].source);
+        memcpy(p, " -- ", 4);
+        p    = graph_format(p + 4, graph->edge[e].destination);
+        *p++ = ';';
+        *p++ = '\n';
+    }
+    ret |= (fwrite(buffer, 1, p - buffer, dot_file) != (size_t)(p - buffer));
+    fprintf(dot_file, "}\n");
+    ret |= (fclose(dot_file) != 0);
+
+    free(buffer);
+    return(ret ? -1 : 0);
+}
+
+/* ************************************************************************ */
+/*                      Corpus                                              */
+/* ************************************************************************ */
+
+/*! \brief Generates a graph of the corpus and writes it, 0 on success. A graph
+ *         is generated again (next attempt of the seed) until it is connected
+ *         and its diameter is within max_diameter
+ */
+static int graph_generate(graph_summary *summary) {
+    graph_t   graph;
+    graph_rng rng;
+    int       generated;
+
+    memset(&graph, 0, sizeof(graph));
+    graph.nodes = config.nodes;
+
+    for (summary->attempts = 1; summary->attempts <= GRAPHGEN_ATTEMPTS; summary->attempts++) {
+        graph_rng_init(&rng, summary->seed, summary->attempts - 1);
+        graph.edges = 0;
+
+        switch (config.model) {
+        case MODEL_BA:
+            generated = generate_ba(&graph, &rng, config.edges_per_node, GRAPHGEN_BA_POWER, GRAPHGEN_BA_ZERO);
+            break;
+
+        case MODEL_WS:
+            generated = generate_ws(&graph, &rng, config.edges_per_node, GRAPHGEN_WS_PROB);
+            break;
+
+        case MODEL_ER:
+            generated = generate_er(&graph, &rng, config.edges);
+            break;
+
+        default:
+            generated = generate_regular(&graph, &rng, 2 * config.edges_per_node);
+            break;
+        }
+
+        if (generated == 0 && graph_check(&graph, config.exact, config.max_diameter, summary) && summary->upper <= config.max_diameter) {
+            break;
+        }
+    }
+    if (summary->attempts > GRAPHGEN_ATTEMPTS) {
+        fprintf(stdout, "FATAL ERROR, graph %d: no connected graph with diameter <= %u in %d attempts\n", summary->number, config.max_diameter, GRAPHGEN_ATTEMPTS);
+        free(graph.edge);
+        return(-1);
+    }
+
+    if (graph_write_dot(&graph, summary->name) != 0) {
+        fprintf(stdout, "FATAL ERROR, impossible to write the graph: %s\n", summary->name);
+        free(graph.edge);
+        return(-1);
+    }
+    if (config.binary && topology_save(summary->name, graph.edge, graph.edges, graph.nodes) != 0) {
+        fprintf(stdout, "FATAL ERROR, impossible to write the binary topology of: %s\n", summary->name);
+        free(graph.edge);
+        return(-1);
+    }
+
+    free(graph.edge);
+    return(0);
+}
+
+/*! \brief Worker thread: generates the next graphs of the corpus, until none is left
+ */
+static void *graph_worker(void *arg) {
+    graph_summary *summary;
+    int            g;
+
+    (void)arg;                                          // The work is shared through corpus_next
+    for (;;) {
+        pthread_mutex_lock(&corpus_mutex);
+        g = corpus_next++;
+        pthread_mutex_unlock(&corpus_mutex);
+        if (g >= config.count) {
+            break;
+        }
+
+        summary         = &corpus[g];
+        summary->failed = graph_generate(summary);
+
+        pthread_mutex_lock(&corpus_mutex);
+        if (!summary->failed) {
+            fprintf(stdout, "Graph %d of %d (seed %lu): %lu edges, degree %u-%u, diameter %u", summary->number, config.count,
+                    (unsigned long)summary->seed, (unsigned long)summary->edges, summary->degree_min, summary->degree_max, summary->diameter);
+            if (summary->upper > summary->diameter) {
+                fprintf(stdout, " (upper bound %u)", summary->upper);
+            }
+            fprintf(stdout, ", %s\n", summary->name);
+            fflush(stdout);
+        }
+        pthread_mutex_unlock(&corpus_mutex);
+    }
+    return(NULL);
+}
+
+/*! \brief Machine-readable summary of the corpus: a line for each graph, tab
+ *         separated, after a header line
+ */
+static int graph_write_summary(const char *summary_name) {
+    FILE *summary_file;
+    int   g;
+
+    if ((summary_file = fopen(summary_name, "w")) == NULL) {
+        return(-1);
+    }
+    fprintf(summary_file, "#graph\tseed\tnodes\tedges\tconnected\tdiameter\tdiameter_upper\tdegree_min\tdegree_max\tdegree_mean\tattempts\tfile\n");
+    for (g = 0; g < config.count; g++) {
+        fprintf(summary_file, "%d\t%lu\t%u\t%lu\t%d\t%u\t%u\t%u\t%u\t%.3f\t%d\t%s\n", corpus[g].number, (unsigned long)corpus[g].seed,
+                config.nodes, (unsigned long)corpus[g].edges, corpus[g].connected, corpus[g].diameter, corpus[g].upper,
+                corpus[g].degree_min, corpus[g].degree_max, corpus[g].degree_mean, corpus[g].attempts, corpus[g].name);
+    }
+    return((fclose(summary_file) == 0) ? 0 : -1);
+}
+
+/*! \brief True if the output name has a single "%d" (number of the graph) and
+ *         no other conversion
+ */
+static int graph_valid_pattern(const char *pattern) {
+    const char *p;
+    int         numbers = 0;
+
+    for (p = strchr(pattern, '%'); p != NULL; p = strchr(p + 2, '%')) {
+        if (p[1] != 'd') {
+            return(0);
+        }
+        numbers++;
+    }
+    return(numbers == 1);
+}
+
+/* ************************************************************************ */
+/*                      Main                                                */
+/* ************************************************************************ */
+
 int main(int argc, char *argv[]) {
-    igraph_t         graph;
-    igraph_integer_t nodes;
-    igraph_integer_t diameter;
-    igraph_bool_t    result = (igraph_bool_t)0;
-    FILE *           output_dot;
-    FILE *           fstatus;
-    igraph_integer_t max_diameter;
-    igraph_integer_t edges;
-    igraph_integer_t edges_per_node;
-
-    if (argc != 5) {
+    pthread_t * thread;
+    uint64_t    seed         = 1;
+    char *      summary_name = "status.txt";
+    int         threads      = 0;
+    int         option, g, t, failed = 0;
+
+    memset(&config, 0, sizeof(config));
+    config.model = MODEL_BA;
+    config.count = 1;
+
+    while ((option = getopt(argc, argv, "m:s:n:t:o:bx")) != -1) {
+        switch (option) {
+        case 'm':
+            if (strcmp(optarg, "ba") == 0) {
+                config.model = MODEL_BA;
+            }else if (strcmp(optarg, "ws") == 0) {
+                config.model = MODEL_WS;
+            }else if (strcmp(optarg, "er") == 0) {
+                config.model = MODEL_ER;
+            }else if (strcmp(optarg, "regular") == 0) {
+                config.model = MODEL_REGULAR;
+            }else {
+                print_usage();
+            }
+            break;
+
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+
+        case 'n':
+            config.count = atoi(optarg);
+            break;
+
+        case 't':
+            threads = atoi(optarg);
+            break;
+
+        case 'o':
+            summary_name = optarg;
+            break;
+
+        case 'b':
+            config.binary = 1;
+            break;
+
+        case 'x':
+            config.exact = 1;
+            break;
+
+        default:
+            print_usage();
+        }
+    }
+    if (argc - optind != 4 || config.count < 1 || (config.count > 1 && !graph_valid_pattern(argv[optind + 2]))) {
         print_usage();
     }
 
-    nodes        = (igraph_integer_t)atoi(argv[1]);
-    edges        = (igraph_integer_t)atof(argv[2]);
-    max_diameter = (igraph_integer_t)atoi(argv[4]);
-
-    edges_per_node = (igraph_integer_t)edges / nodes;
+    config.nodes        = (uint32_t)atol(argv[optind]);
+    config.edges        = (uint64_t)atof(argv[optind + 1]);
+    config.max_diameter = (uint32_t)atoi(argv[optind + 3]);
 
-    if (nodes == 0 || edges <= nodes - 1 || max_diameter == 0 || edges_per_node == 0) {
+    if (config.nodes == 0 || config.edges <= (uint64_t)config.nodes - 1 || config.max_diameter == 0) {
         print_usage();
     }
+    config.edges_per_node = (uint32_t)(config.edges / config.nodes);
 
-    fprintf(stdout, "Generating a graph with %d vertices and %d edges (~%d edges per node)\n", (int)nodes, (int)edges, (int)edges_per_node);
+    // Constraints of the models
+    if ((config.model == MODEL_WS && 2 * (uint64_t)config.edges_per_node >= config.nodes) ||
+        (config.model == MODEL_REGULAR && 2 * (uint64_t)config.edges_per_node >= config.nodes) ||
+        (config.model == MODEL_ER && config.edges > (uint64_t)config.nodes * (config.nodes - 1) / 2)) {
+        fprintf(stdout, "FATAL ERROR, too many edges for the model\n");
+        exit(-1);
+    }
+
+    // One thread for each core, not more than the graphs
+    threads = (threads < 1) ? (int)sysconf(_SC_NPROCESSORS_ONLN) : threads;
+    threads = MAX(MIN(threads, config.count), 1);
+
+    fprintf(stdout, "Generating %d graph(s) with %u vertices and %lu edges (~%u edges per node), seed %lu, %d thread(s)\n", config.count,
+            config.nodes, (unsigned long)config.edges, config.edges_per_node, (unsigned long)seed, threads);
     fflush(stdout);
 
-    while ((int)(result) != 1) {
-        //igraph_erdos_renyi_game(&graph, IGRAPH_ERDOS_RENYI_GNM, nodes, edges, IGRAPH_UNDIRECTED, IGRAPH_NO_LOOPS);
-        //igraph_watts_strogatz_game(&graph, /*dim=*/ 1, /*size=*/ nodes, /*nei=*/ edges_per_node, /*p=*/ 0.1, /*loops=*/ 0, /*multiple=*/ 0);
-        // igraph_k_regular_game(&graph, nodes, edges_per_node, 0, 0);
-        igraph_barabasi_game(&graph, nodes, 1.6, 4, NULL, 0, 1, 0, IGRAPH_BARABASI_PSUMTREE, NULL);
-        igraph_is_connected(&graph, &result, IGRAPH_STRONG);
-        igraph_diameter(&graph, &diameter, 0, 0, 0, IGRAPH_UNDIRECTED, 1);
-        // if is not connected (result == 0), the diameter constraint is not valid
-        if ((int)(result) == 0 && diameter > max_diameter) {
-            igraph_destroy(&graph);
+    // The graph "g" (from 1) has the seed "seed + g - 1"
+    corpus = (graph_summary *)calloc(config.count, sizeof(graph_summary));
+    thread = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    if (corpus == NULL || thread == NULL) {
+        fprintf(stdout, "FATAL ERROR, graphgen: malloc error\n");
+        exit(-1);
+    }
+    for (g = 0; g < config.count; g++) {
+        corpus[g].number = g + 1;
+        corpus[g].seed   = seed + g;
+        if (config.count > 1) {
+            snprintf(corpus[g].name, sizeof(corpus[g].name), argv[optind + 2], g + 1);
+        }else {
+            snprintf(corpus[g].name, sizeof(corpus[g].name), "%s", argv[optind + 2]);
         }
     }
 
-    printf("\nConnected graph? (0/1): %d\n", (int)result);
-    printf("Diameter of the graph: %d\n", (int)diameter);
-    printf("Number of vertices in the graph: %d\n", (int)igraph_vcount(&graph));
-    printf("Number of edges in the graph: %d\n", (int)igraph_ecount(&graph));
-
-    output_dot = fopen(argv[3], "w");
-    igraph_write_graph_dot(&graph, output_dot);
-    fclose(output_dot);
+    for (t = 1; t < threads; t++) {
+        if (pthread_create(&thread[t], NULL, graph_worker, NULL) != 0) {
+            fprintf(stdout, "FATAL ERROR, impossible to start the generator thread %d\n", t);
+            exit(-1);
+        }
+    }
+    graph_worker(NULL);
+    for (t = 1; t < threads; t++) {
+        pthread_join(thread[t], NULL);
+    }
 
-    fstatus = fopen("status.txt", "w");
-    fprintf(fstatus, "Diameter of the graph: %d\n", (int)diameter);
-    fclose(fstatus);
+    for (g = 0; g < config.count; g++) {
+        failed |= corpus[g].failed;
+    }
+    if (graph_write_summary(summary_name) != 0) {
+        fprintf(stdout, "FATAL ERROR, impossible to write the summary: %s\n", summary_name);
+        exit(-1);
+    }
 
-    igraph_destroy(&graph);
-    return(0);
+    free(corpus);
+    free(thread);
+    return(failed ? -1 : 0);
 }
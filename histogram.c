@@ -0,0 +1,145 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Log-bucketed histograms (in the style of HDR histograms):
+ *                      the buckets are fixed (see histogram.h), recording a value
+ *                      is O(1) and it does not allocate memory, so they can be
+ *                      kept by each worker and merged later
+ *              -	The histograms of many LPs (or runs) are merged summing the
+ *                      buckets with the same bounds, see histogram_dump()
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "histogram.h"
+
+
+/*! \brief Bucket of a value
+ */
+static int histogram_index(uint32_t value) {
+    int shift;
+
+    if (value < HISTOGRAM_LINEAR) {
+        return(value);
+    }
+    // Most significant bit of the value, the next HISTOGRAM_BITS - 1 bits select the bucket
+    shift = (31 - __builtin_clz(value)) - HISTOGRAM_BITS + 1;
+    return(shift * (HISTOGRAM_LINEAR / 2) + (int)(value >> shift));
+}
+
+/*! \brief Smallest value of a bucket
+ */
+static uint32_t histogram_lower(int index) {
+    int shift;
+
+    if (index < HISTOGRAM_LINEAR) {
+        return(index);
+    }
+    shift = index / (HISTOGRAM_LINEAR / 2) - 1;
+    return((uint32_t)(index - shift * (HISTOGRAM_LINEAR / 2)) << shift);
+}
+
+/*! \brief Largest value of a bucket
+ */
+static uint32_t histogram_upper(int index) {
+    int shift = index < HISTOGRAM_LINEAR ? 0 : index / (HISTOGRAM_LINEAR / 2) - 1;
+
+    return(histogram_lower(index) + ((1U << shift) - 1));
+}
+
+/*! \brief An empty histogram
+ */
+void histogram_init(histogram_t *histogram) {
+    memset(histogram, 0, sizeof(histogram_t));
+    histogram->min = UINT32_MAX;
+}
+
+/*! \brief Records a value
+ */
+void histogram_record(histogram_t *histogram, uint32_t value) {
+    histogram->bucket[histogram_index(value)]++;
+    histogram->count++;
+    histogram->total += value;
+    if (value < histogram->min) {
+        histogram->min = value;
+    }
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+/*! \brief Adds the values of a histogram to another one
+ */
+void histogram_merge(histogram_t *histogram, const histogram_t *other) {
+    int i;
+
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        histogram->bucket[i] += other->bucket[i];
+    }
+    histogram->count += other->count;
+    histogram->total += other->total;
+    if (other->min < histogram->min) {
+        histogram->min = other->min;
+    }
+    if (other->max > histogram->max) {
+        histogram->max = other->max;
+    }
+}
+
+/*! \brief The value below which falls the given percentage of the recorded
+ *         values (the largest value of its bucket), 0 if the histogram is empty
+ */
+uint32_t histogram_percentile(const histogram_t *histogram, double percentile) {
+    uint64_t rank, seen = 0;
+    uint32_t upper;
+    int      i;
+
+    if (histogram->count == 0) {
+        return(0);
+    }
+    rank = (uint64_t)ceil(percentile / 100.0 * (double)histogram->count);
+    rank = rank < 1 ? 1 : rank;
+
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->bucket[i];
+        if (seen >= rank) {
+            upper = histogram_upper(i);
+            return(upper < histogram->max ? upper : histogram->max);
+        }
+    }
+    return(histogram->max);
+}
+
+/*! \brief Mean of the recorded values (it is exact)
+ */
+double histogram_mean(const histogram_t *histogram) {
+    return(histogram->count ? (double)histogram->total / (double)histogram->count : 0.0);
+}
+
+/*! \brief A line with the main percentiles
+ */
+void histogram_summary(FILE *out, const char *name, const histogram_t *histogram) {
+    fprintf(out, "%s: count %llu, mean %.2f, min %u, p50 %u, p90 %u, p99 %u, p99.9 %u, max %u\n", name,
+            (unsigned long long)histogram->count, histogram_mean(histogram), histogram->count ? histogram->min : 0,
+            histogram_percentile(histogram, 50.0), histogram_percentile(histogram, 90.0),
+            histogram_percentile(histogram, 99.0), histogram_percentile(histogram, 99.9), histogram->max);
+}
+
+/*! \brief All the non-empty buckets, a line each: "name lower upper count"
+ */
+void histogram_dump(FILE *out, const char *name, const histogram_t *histogram) {
+    int i;
+
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (histogram->bucket[i] > 0) {
+            fprintf(out, "%s %u %u %llu\n", name, histogram_lower(i), histogram_upper(i), (unsigned long long)histogram->bucket[i]);
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,47 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "histogram.c" description
+ *              -	Layout of the buckets
+ *              -	Function prototypes
+ *
+ ############################################################################################### */
+
+#ifndef __HISTOGRAM_H
+#define __HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+// The values below HISTOGRAM_LINEAR have a bucket each, the others share the
+//	buckets of their power of two in HISTOGRAM_LINEAR / 2 parts: the relative
+//	error of a value is at most 2 / HISTOGRAM_LINEAR
+#define HISTOGRAM_BITS        6
+#define HISTOGRAM_LINEAR      (1 << HISTOGRAM_BITS)
+#define HISTOGRAM_BUCKETS     ((32 - HISTOGRAM_BITS + 2) * (HISTOGRAM_LINEAR / 2))
+
+/*! \brief Log-bucketed histogram of 32 bits values, in a fixed amount of memory
+ */
+typedef struct histogram_t {
+    uint64_t count;                         // Recorded values
+    uint64_t total;                         // Their sum
+    uint32_t min, max;
+    uint64_t bucket[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+void     histogram_init(histogram_t *);
+void     histogram_record(histogram_t *, uint32_t);
+void     histogram_merge(histogram_t *, const histogram_t *);
+uint32_t histogram_percentile(const histogram_t *, double);
+double   histogram_mean(const histogram_t *);
+void     histogram_summary(FILE *, const char *, const histogram_t *);
+void     histogram_dump(FILE *, const char *, const histogram_t *);
+
+#endif /* __HISTOGRAM_H */
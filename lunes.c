@@ -29,7 +29,13 @@
 #include <rnd.h>
 #include <values.h>
 #include "utils.h"
+#include "rng.h"
+#include "pool.h"
+#include "topology.h"
+#include "metrics.h"
+#include "histogram.h"
 #include "user_event_handlers.h"
+#include "context.h"
 #include "lunes.h"
 #include "lunes_constants.h"
 #include "entity_definition.h"
@@ -47,13 +53,11 @@ unsigned short env_max_ttl = MAX_TTL; // TTL of newly created messages
 /*          E X T E R N A L     V A R I A B L E S                           */
 /* ************************************************************************ */
 
-extern hash_t hash_table, *table;                   /* Global hash table of simulated entities */
-extern hash_t sim_table, *stable;                   /* Hash table of locally simulated entities */
-extern double simclock;                             /* Time management, simulated time */
 extern TSeed  Seed, *S;                             /* Seed used for the random generator */
 extern char * TESTNAME;                             /* Test name */
 extern int    NSIMULATE;                            /* Number of Interacting Agents (Simulated Entities) per LP */
 extern int    NLP;                                  /* Number of Logical Processes */
+extern int    LPID;                                 /* Identification number of the local LP */
 // Simulation control
 extern unsigned short env_dissemination_mode;       /* Dissemination mode */
 extern float          env_broadcast_prob_threshold; /* Dissemination: conditional broadcast, probability threshold */
@@ -61,23 +65,88 @@ extern float          env_fixed_prob_threshold;     /* Dissemination: fixed prob
 extern float   		  env_dandelion_stem_steps;	    /* Dissemination: dandelion, number of stem steps */
 extern unsigned int   env_probability_function;     /* Probability function for Degree Dependent Gossip */
 extern double         env_function_coefficient;     /* Coefficient of the probability function */
-extern int            applicant;                    /* ID of the applicant node*/
-extern int            holder;                       /* ID of the holder node*/
+extern int            env_lookups;                  /* Concurrent lookups in each epoch */
+extern unsigned int   env_cache_size;               /* Cache size of each node */
+extern int            env_bulk_links;               /* Links of the topology built locally, without link messages */
 extern unsigned short env_max_ttl;                  /* TTL of new messages */
+extern float          env_end_clock;                /* End clock (simulated time) */
 extern int 			  env_perc_active_nodes_;		/* Initial percentage of active node*/
-extern long 		  countMessages;
-extern int 			  countEpochs;
-extern int 			  countDelivers;
-extern double		  countSteps;
+extern int            env_metrics;                  /* Per-epoch metrics stream */
+extern int            env_restore;                  /* Timestep of the checkpoint to resume from */
+extern int            env_replicas;                 /* Replicas of the run in this process */
+
+
+// A node and a lookup in a single integer (see stem_watch)
+#define LOOKUP_INDEX(_key, _lookup)    ((_key) * env_lookups + (_lookup))
+
+// Messages seen by a node: a ring of env_cache_size entries, the oldest entry is
+//	replaced. The identifiers of the messages change at each epoch, so the entries
+//	of the past epochs simply do not match
+typedef struct seen_entry {
+    int   id;                               // Message identifier, -1 empty
+    short received;                         // 0 not received, >0 received (step, relative to the epoch of the entry), -1 received back in the fluff phase
+    char  forwarded;                        // The node forwarded the message
+} seen_entry;
+
+// Activity of a node in the control phase of a timestep
+#define CHURN_NONE      0
+#define CHURN_ATTACH    1                   // Activation
+#define CHURN_DETACH    2                   // Deactivation
+
+typedef struct churn_action {
+    int  key;                               // ID of the node
+    char due;                               // The node has a scheduled change of activity
+    char isolated;                          // The node has been marked as isolated
+    char action;                            // CHURN_*
+    int  next;                              // Next scheduled change (-1 none)
+} churn_action;
+
+// Data of each worker thread (see pool.c), they are summed or merged by the main thread
+typedef struct lunes_worker_t {
+    long    messages;                       // Statistics: received messages
+    int     delivers;                       // Statistics: messages delivered to the holder
+    double  steps;                          // Statistics: steps to reach the holder
+    int     lookup_delivers[MAX_LOOKUPS];   // Statistics: messages delivered, for each lookup
+    metrics_record epoch;                   // Statistics of the current epoch (messages, delivers, hops and covered)
+    histogram_t    hops;                    // Statistics: hops of the messages delivered to the holder
+    GArray *isolated;                       // Nodes marked as isolated by this worker
+    GArray *stem;                           // New candidates for the recovery, found by this worker
+} __attribute__ ((aligned(POOL_ALIGN))) lunes_worker_t;
+
+/*! \brief State of the model level in a simulation context (see context.h)
+ */
+struct lunes_model {
+    int tempcountLinks;
+    int tempcountActive;
+
+    calendar_t churn_calendar;              // Next change of activity of the local nodes
+    GArray *   churn_due;                   // Nodes that change activity in the current timestep
+    GArray *   churn_actions;               // Nodes with some activity in the current timestep (see churn_action)
+    GArray *   isolated_watch;              // Active nodes that lost all their neighbors
+    GArray *   stem_watch;                  // Nodes that could start the recovery of Dandelion+ and Dandelion++ (see LOOKUP_INDEX)
+
+    // Progress of the applicant and of the holder in the concurrent lookups of the
+    //	epoch (LOOKUP_*, see lunes_constants.h), the other nodes use their cache
+    unsigned char lookup_applicant[MAX_LOOKUPS];
+    unsigned char lookup_holder[MAX_LOOKUPS];
+    int           lookup_started[MAX_LOOKUPS];  // Statistics: lookups started by the local applicants, for each lookup
+
+    seen_entry *    seen_cache;             // Cache of each node, indexed by ID * env_cache_size
+    unsigned short *seen_next;              // Next entry to replace in the ring of each node
 
+    unsigned int *  load;                   // Requests received by each node (indexed by ID)
 
-int tempcountLinks=0;
-int tempcountActive=0;
+    int             configuration;          // Configuration of the sweep (see SWEEP), 0 the LP itself
+    metrics_record  epoch;                  // Record of the current epoch (epoch -1 none), completed at its end
+    metrics_t *     metrics;                // Per-epoch metrics stream (NULL if not enabled, see METRICS)
+
+    lunes_worker_t *worker_data;
+};
 
 
 /*! \brief Used to calculate the forwarding probability value for a given node
  */
-double lunes_degdependent_prob(unsigned int deg) {
+double lunes_degdependent_prob(context_t *ctx, unsigned int deg) {
     double prob = 0.0;
 
     switch (env_probability_function) {
@@ -92,7 +161,7 @@ double lunes_degdependent_prob(unsigned int deg) {
         break;
 
     default:
-        fprintf(stdout, "%12.2f FATAL ERROR, function: %d does NOT exist!\n", simclock, env_probability_function);
+        fprintf(stdout, "%12.2f FATAL ERROR, function: %d does NOT exist!\n", ctx->simclock, env_probability_function);
         fflush(stdout);
         exit(-1);
         break;
@@ -108,21 +177,139 @@ double lunes_degdependent_prob(unsigned int deg) {
     return(prob);
 }
 
-int is_in_array (gpointer arr[], int length, gpointer elem){
+int is_in_array (int arr[], int length, int elem){
 	int i;
 	for (i=0; i< length; i++){
-		if (arr[i] == NULL){
-			return 0;
-		}
-		else if (arr[i] == elem){
+		if (arr[i] == elem){
 			return 1;
 		}
 	}
 	return 0;
 }
 
-int is_in_stem_mode (hash_node_t *node){
-    int epoch = (int)simclock / env_max_ttl;
+/*! \brief Entry of a message in the cache of a node, NULL if not there
+ */
+static seen_entry *lunes_seen_find(context_t *ctx, hash_node_t *node, int id) {
+    seen_entry *entry = &ctx->model->seen_cache[(size_t)node->data->key * env_cache_size];
+    unsigned int i;
+
+    for (i = 0; i < env_cache_size; i++) {
+        if (entry[i].id == id) {
+            return(&entry[i]);
+        }
+    }
+    return(NULL);
+}
+
+/*! \brief Entry of a message in the cache of a node, a new one (replacing the
+ *         oldest) if not there
+ */
+static seen_entry *lunes_seen_insert(context_t *ctx, hash_node_t *node, int id) {
+    seen_entry *entry;
+
+    if ((entry = lunes_seen_find(ctx, node, id)) == NULL) {
+        entry = &ctx->model->seen_cache[(size_t)node->data->key * env_cache_size + ctx->model->seen_next[node->data->key]];
+        ctx->model->seen_next[node->data->key] = (ctx->model->seen_next[node->data->key] + 1) % env_cache_size;
+
+        entry->id        = id;
+        entry->received  = 0;
+        entry->forwarded = 0;
+    }
+    return(entry);
+}
+
+/*! \brief True if the node already forwarded the message (as far as its cache remembers)
+ */
+int lunes_seen(context_t *ctx, hash_node_t *node, int id) {
+    seen_entry *entry = lunes_seen_find(ctx, node, id);
+
+    return(entry != NULL && entry->forwarded);
+}
+
+/*! \brief The node forwarded the message
+ */
+void lunes_set_seen(context_t *ctx, hash_node_t *node, int id) {
+    seen_entry *entry = lunes_seen_insert(ctx, node, id);
+
+    ctx->model->worker_data[pool_worker()].epoch.covered += !entry->forwarded;
+    entry->forwarded = 1;
+}
+
+/*! \brief The node went off, once active again it can forward the messages it has seen
+ */
+void lunes_clear_seen(context_t *ctx, hash_node_t *node) {
+    seen_entry *entry = &ctx->model->seen_cache[(size_t)node->data->key * env_cache_size];
+    unsigned int i;
+
+    for (i = 0; i < env_cache_size; i++) {
+        entry[i].forwarded = 0;
+    }
+}
+
+/*! \brief Step of the last reception of a message by a node: 0 nothing received,
+ *         -1 received back in the fluff phase. The step is stored relative to the
+ *         beginning of the current epoch (see seen_entry), the messages of a lookup
+ *         live in a single epoch
+ */
+int lunes_get_received(context_t *ctx, hash_node_t *node, int id) {
+    seen_entry *entry = lunes_seen_find(ctx, node, id);
+
+    if (entry == NULL || entry->received <= 0) {
+        return(entry == NULL ? 0 : entry->received);
+    }
+    return((int)ctx->simclock - (int)ctx->simclock % env_max_ttl + entry->received - 1);
+}
+
+/*! \brief Records the step of reception of a message (or 0, -1, see above)
+ */
+void lunes_set_received(context_t *ctx, hash_node_t *node, int id, int received) {
+    seen_entry *entry = lunes_seen_insert(ctx, node, id);
+    int         index;
+
+    if (received > 0) {
+        if (entry->received <= 0 &&
+            (env_dissemination_mode == DANDELIONPLUS || env_dissemination_mode == DANDELIONPLUSPLUS)) {
+            index = LOOKUP_INDEX(node->data->key, id % env_lookups);
+            g_array_append_val(ctx->model->worker_data[pool_worker()].stem, index);
+        }
+        received = received - ((int)ctx->simclock - (int)ctx->simclock % env_max_ttl) + 1;
+    }
+    entry->received = (short)received;
+}
+
+/*! \brief Identifier of the message of a lookup in the current epoch, carried
+ *         in the requests (the lookup is the identifier modulo env_lookups)
+ */
+int lunes_lookup_id(context_t *ctx, int lookup) {
+    return(((int)ctx->simclock / env_max_ttl) * env_lookups + lookup);
+}
+
+/*! \brief True if the node is the applicant or the holder of a lookup of the
+ *         epoch (and it still has this role)
+ */
+int lunes_lookup_role(context_t *ctx, hash_node_t *node) {
+    int k;
+
+    for (k = 0; k < env_lookups; k++) {
+        if ((ctx->applicant[k] == node->data->key && ctx->model->lookup_applicant[k] == LOOKUP_APPLICANT) ||
+            (ctx->holder[k] == node->data->key && (ctx->model->lookup_holder[k] == LOOKUP_HOLDER || ctx->model->lookup_holder[k] == LOOKUP_DELIVERED))) {
+            return(1);
+        }
+    }
+    return(0);
+}
+
+/*! \brief True if the message of a lookup has not reached the node yet (it is
+ *         neither the applicant nor the holder and it did not forward the message)
+ */
+static int lunes_lookup_idle(context_t *ctx, hash_node_t *node, int id) {
+    int k = id % env_lookups;
+
+    return(ctx->applicant[k] != node->data->key && ctx->holder[k] != node->data->key && !lunes_seen(ctx, node, id));
+}
+
+int is_in_stem_mode(context_t *ctx, hash_node_t *node){
+    int epoch = (int)ctx->simclock / env_max_ttl;
 	if ((node->data->key + epoch * 7) % 100 <= env_dandelion_stem_steps){  //is in stem mode, dependent on key and epoch
 		return 1;
 	}
@@ -142,12 +329,15 @@ int is_in_stem_mode (hash_node_t *node){
  *  @param[in] creator: Node sender
  *  @param[in] forwarder: Agent forwarder
  */
-void lunes_real_forward(hash_node_t *node, Msg *msg, unsigned short ttl, float timestamp, int id, unsigned int creator, unsigned int forwarder) {
-    // Iterator to scan the whole state hashtable of neighbors
-    GHashTableIter iter;
-    gpointer       key, destination;
+void lunes_real_forward(context_t *ctx, hash_node_t *node, Msg *msg, unsigned short ttl, float timestamp, int id, unsigned int creator, unsigned int forwarder) {
+    // Row of the adjacency snapshot with all the neighbors
+    adj_row *      row = &node->data->neighbors;
+    unsigned int   i;
+    int            position;          // Position in the row of a neighbor chosen at random
     float          threshold;         // Tmp, used for probabilistic-based dissemination algorithms
-    hash_node_t *  sender, *receiver; // Sender and receiver nodes in the global hashtable
+    double         thresholds[RNG_BATCH];
+    hash_node_t *  sender = node;     // Sender: this node
+    hash_node_t *  receiver;          // Receiver: a neighbor, resolved when the link was created
 
         // Dissemination mode for the forwarded messages (dissemination algorithm)
     switch (env_dissemination_mode) {
@@ -155,61 +345,51 @@ void lunes_real_forward(hash_node_t *node, Msg *msg, unsigned short ttl, float t
             // The message is forwarded to ALL neighbors of this node
             // NOTE: in case of probabilistic broadcast dissemination this function is called
             //		 only if the probabilities evaluation was positive
-            g_hash_table_iter_init(&iter, node->data->state);
 
             // All neighbors
-            while (g_hash_table_iter_next(&iter, &key, &destination)) {
-                sender   = hash_lookup(stable, node->data->key);             // This node
-                receiver = hash_lookup(table, *(unsigned int *)destination); // The neighbor
+            for (i = 0; i < row->count; i++) {
+                receiver = row->record[i].elements.node;                     // The neighbor
 
                 // The original forwarder of this message and its creator are exclueded
                 // from this dissemination
                 if ((receiver->data->key != forwarder) && (receiver->data->key != creator)) {
-                    execute_request (simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+                    execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
                 }
             }
             break;
 
         case DANDELION:
         case DANDELIONPLUS:
-            g_hash_table_iter_init (&iter, node->data->state);
             if (env_max_ttl - ttl <=  env_dandelion_stem_steps ){                   //stem phase
-            	if (node->data->num_neighbors > 0){
-	    	        sender   = hash_lookup(stable, node->data->key);             // This node
-	                destination = hash_table_random_key(node->data->state);                    
-	                receiver = hash_lookup(table, *(unsigned int *)destination);        // The neighbor
-	                execute_request (simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+            	if (SE_NUM_NEIGHBORS(ctx, node) > 0 && (position = adj_row_random(row, rng_next(&ctx->rng, sender->data->key, (int)ctx->simclock, RNG_FORWARD))) != -1){
+	                receiver = row->record[position].elements.node;              // The neighbor
+	                execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
 	            } 
             } else {                                                                //fluff phase, sending messages to everyone, except the forwarder
-                while (g_hash_table_iter_next (&iter, &key, &destination)) {
+                for (i = 0; i < row->count; i++) {
 
-                    sender = hash_lookup(stable, node->data->key);                  // This node
-                    receiver = hash_lookup(table, *(unsigned int *)destination);    // The neighbor
+                    receiver = row->record[i].elements.node;                        // The neighbor
 
                     if (receiver->data->key != forwarder )
-                        execute_request(simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+                        execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
                 }
             }
         break;
 
         case DANDELIONPLUSPLUS:
-            g_hash_table_iter_init (&iter, node->data->state);
-           	if ( is_in_stem_mode(node) ==0) {           
+           	if ( is_in_stem_mode(ctx, node) ==0) {           
 
-	            while (g_hash_table_iter_next (&iter, &key, &destination)) {
-	                sender = hash_lookup(stable, node->data->key);                  // This node
-	                receiver = hash_lookup(table, *(unsigned int *)destination);    // The neighbor
+	            for (i = 0; i < row->count; i++) {
+	                receiver = row->record[i].elements.node;                        // The neighbor
 
 	                if (receiver->data->key != forwarder )
-	                    execute_request(simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+	                    execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
             	} 
             } else {
 
-            	if (node->data->num_neighbors > 0){
-	    	        sender   = hash_lookup(stable, node->data->key);             // This node
-	                destination = hash_table_random_key(node->data->state);                    
-	                receiver = hash_lookup(table, *(unsigned int *)destination);        // The neighbor
-	                execute_request (simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+            	if (SE_NUM_NEIGHBORS(ctx, node) > 0 && (position = adj_row_random(row, rng_next(&ctx->rng, sender->data->key, (int)ctx->simclock, RNG_FORWARD))) != -1){
+	                receiver = row->record[position].elements.node;              // The neighbor
+	                execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
 	            } 
             }
 
@@ -218,55 +398,58 @@ void lunes_real_forward(hash_node_t *node, Msg *msg, unsigned short ttl, float t
         case GOSSIP_FIXED_PROB:
             // In this case, all neighbors will be analyzed but the message will be
             // forwarded only to some of them
-            g_hash_table_iter_init(&iter, node->data->state);
 
             // All neighbors
-            while (g_hash_table_iter_next(&iter, &key, &destination)) {
-                // Probabilistic evaluation
-                threshold = RND_Interval(S, (double)0, (double)100);
+            for (i = 0; i < row->count; i++) {
+                // Probabilistic evaluation, the thresholds are drawn in batches
+                if (i % RNG_BATCH == 0) {
+                    rng_uniform_batch(&ctx->rng, sender->data->key, (int)ctx->simclock, RNG_FORWARD, thresholds, MIN(RNG_BATCH, row->count - i));
+                }
+                threshold = thresholds[i % RNG_BATCH] * 100;
 
                 if (threshold <= env_fixed_prob_threshold) {
-                    sender   = hash_lookup(stable, node->data->key);             // This node
-                    receiver = hash_lookup(table, *(unsigned int *)destination); // The neighbor
+                    receiver = row->record[i].elements.node;                     // The neighbor
 
                     // The original forwarder of this message and its creator are exclueded
                     // from this dissemination
                     if ((receiver->data->key != forwarder) && (receiver->data->key != creator)) {
-                        execute_request(simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+                        execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
                     }
                 }
             }
             break;
         // Degree Dependent dissemination algorithm
         case DEGREE_DEPENDENT_GOSSIP:
-            g_hash_table_iter_init(&iter, node->data->state);
 
             // All neighbors
-            while (g_hash_table_iter_next(&iter, &key, &destination)) {
-                sender   = hash_lookup(stable, node->data->key);             // This node
-                receiver = hash_lookup(table, *(unsigned int *)destination); // The neighbor
+            for (i = 0; i < row->count; i++) {
+                receiver = row->record[i].elements.node;                     // The neighbor
+
+                // Probabilistic evaluation, the thresholds are drawn in batches
+                if (i % RNG_BATCH == 0) {
+                    rng_uniform_batch(&ctx->rng, sender->data->key, (int)ctx->simclock, RNG_FORWARD, thresholds, MIN(RNG_BATCH, row->count - i));
+                }
 
                 // The original forwarder of this message and its creator are excluded
                 // from this dissemination
                 if ((receiver->data->key != forwarder) && (receiver->data->key != creator)) {
-                    // Probabilistic evaluation
-                    threshold = (RND_Interval(S, (double)0, (double)100)) / 100;
+                    threshold = thresholds[i % RNG_BATCH];
 
                     // If the eligible recipient has less than 3 neighbors, its reception probability is 1. However,
                     // if its value of num_neighbors is 0, it means that I don't know the dimension of
                     // that node's neighborhood, so the threshold is set to 1/n, being n
                     // the dimension of my neighborhood
-                    if (receiver->data->num_neighbors < 3) {
+                    if (SE_NUM_NEIGHBORS(ctx, receiver) < 3) {
                         // Note that, the startup phase (when the number of neighbors is not known) falls in
                         // this case (num_neighbors = 0)
                         // -> full dissemination
-                        execute_request(simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+                        execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
                     }
                     // Otherwise, the probability is evaluated according to the function defined by the
                     // environment variable env_probability_function
                     else{
-                        if (threshold <= lunes_degdependent_prob(receiver->data->num_neighbors)) {
-                            execute_request(simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+                        if (threshold <= lunes_degdependent_prob(ctx, SE_NUM_NEIGHBORS(ctx, receiver))) {
+                            execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
                         }
                     }
                 }
@@ -274,33 +457,30 @@ void lunes_real_forward(hash_node_t *node, Msg *msg, unsigned short ttl, float t
             break;
 
             case FIXED_FANOUT:
-        	g_hash_table_iter_init (&iter, node->data->state);
-        	sender   = hash_lookup(stable, node->data->key);             // This node
-
-        	if (node->data->num_neighbors <= 3) {
-        		while (g_hash_table_iter_next(&iter, &key, &destination)) {
-	                receiver = hash_lookup(table, *(unsigned int *)destination); // The neighbor
+        	if (row->count <= 3) {
+        		for (i = 0; i < row->count; i++) {
+	                receiver = row->record[i].elements.node;                     // The neighbor
 
 	                // The original forwarder of this message and its creator are exclueded
 	                // from this dissemination
 	                if ((receiver->data->key != forwarder) && (receiver->data->key != creator)) {
-	                    execute_request (simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+	                    execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
 	                }
 	            }
         	} else {
         		int count = 0;
 
-        		threshold = RND_Interval(S, (double)0, (double)100);
         		int number = 3;
-        		gpointer arr [number];
+        		int arr [number];
         		while (count < number){                  
-        			destination = hash_table_random_key(node->data->state); 
-                	receiver = hash_lookup(table, *(unsigned int *)destination);        // The neighbor     
-        			if (is_in_array(arr, number, destination)==0){
-        				arr [count] = destination;
+        			// Distinct neighbors are drawn in O(1) each, the row has more than number of them
+        			position = adj_row_random(row, rng_next(&ctx->rng, sender->data->key, (int)ctx->simclock, RNG_FORWARD));
+        			if (is_in_array(arr, count, position)==0){
+        				arr [count] = position;
       				 	count++;
+        				receiver = row->record[position].elements.node;              // The neighbor
         				if ((receiver->data->key != forwarder) && (receiver->data->key != creator)) {
-		                	execute_request (simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
+		                	execute_request(ctx, ctx->simclock + FLIGHT_TIME, sender, receiver, ttl, id, timestamp, creator);
 		            	}
         			}
         		}
@@ -321,16 +501,16 @@ void lunes_real_forward(hash_node_t *node, Msg *msg, unsigned short ttl, float t
  *  @param[in] creator: Node sender
  *  @param[in] forwarder: Agent forwarder
  */
-void lunes_forward_to_neighbors(hash_node_t *node, Msg *msg, unsigned short ttl, float timestamp, int id, unsigned int creator, unsigned int forwarder) {
+void lunes_forward_to_neighbors(context_t *ctx, hash_node_t *node, Msg *msg, unsigned short ttl, float timestamp, int id, unsigned int creator, unsigned int forwarder) {
     float threshold; // Tmp, probabilistic evaluation
 
     // Dissemination mode for the forwarded messages
     switch (env_dissemination_mode) {
     case BROADCAST:
         // Probabilistic evaluation
-        threshold = RND_Interval(S, (double)0, (double)100);
+        threshold = rng_uniform(&ctx->rng, node->data->key, (int)ctx->simclock, RNG_FORWARD) * 100;
         if (threshold <= env_broadcast_prob_threshold) {
-            lunes_real_forward(node, msg, ttl, timestamp, id, creator, forwarder);
+            lunes_real_forward(ctx, node, msg, ttl, timestamp, id, creator, forwarder);
         }
         break;
 
@@ -340,12 +520,12 @@ void lunes_forward_to_neighbors(hash_node_t *node, Msg *msg, unsigned short ttl,
     case DANDELIONPLUSPLUS:
     case DEGREE_DEPENDENT_GOSSIP:
     case FIXED_FANOUT:
-        lunes_real_forward(node, msg, ttl, timestamp, id, creator, forwarder);
+        lunes_real_forward(ctx, node, msg, ttl, timestamp, id, creator, forwarder);
         break;
 
     default:
-        fprintf(stdout, "%12.2f FATAL ERROR, the dissemination mode [%2d] is NOT implemented in this version of LUNES!!!\n", simclock, env_dissemination_mode);
-        fprintf(stdout, "%12.2f NOTE: all the adaptive protocols require compile time support: see the ADAPTIVE_GOSSIP_SUPPORT define in sim-parameters.h\n", simclock);
+        fprintf(stdout, "%12.2f FATAL ERROR, the dissemination mode [%2d] is NOT implemented in this version of LUNES!!!\n", ctx->simclock, env_dissemination_mode);
+        fprintf(stdout, "%12.2f NOTE: all the adaptive protocols require compile time support: see the ADAPTIVE_GOSSIP_SUPPORT define in sim-parameters.h\n", ctx->simclock);
         fflush(stdout);
         exit(-1);
         break;
@@ -353,16 +533,14 @@ void lunes_forward_to_neighbors(hash_node_t *node, Msg *msg, unsigned short ttl,
 }
 
 
-void lunes_send_request_to_neighbors(hash_node_t *node, int req_id) {
-    // Iterator to scan the whole state hashtable of neighbors
-    GHashTableIter iter;
-    gpointer       key, destination;
+void lunes_send_request_to_neighbors(context_t *ctx, hash_node_t *node, int req_id) {
+    // Row of the adjacency snapshot with all the neighbors
+    adj_row *    row = &node->data->neighbors;
+    unsigned int i;
 
     // All neighbors
-    g_hash_table_iter_init(&iter, node->data->state);
-
-    while (g_hash_table_iter_next(&iter, &key, &destination)) {
-        execute_request(simclock + FLIGHT_TIME, hash_lookup(stable, node->data->key), hash_lookup(table, *(unsigned int *)destination), env_max_ttl, req_id, simclock, node->data->key);
+    for (i = 0; i < row->count; i++) {
+        execute_request(ctx, ctx->simclock + FLIGHT_TIME, node, row->record[i].elements.node, env_max_ttl, req_id, ctx->simclock, node->data->key);
     }
 }
 
@@ -370,66 +548,66 @@ void lunes_send_request_to_neighbors(hash_node_t *node, int req_id) {
 
 /* -----------------------   GRAPHVIZ DOT FILES SUPPORT --------------------- */
 
-/*! \brief Support function for the parsing of graphviz dot files,
- *         used for loading the graphs (i.e. network topology)
+/*! \brief True if the LP of the source sends a link message for the edge
+ *         (see lunes_load_graph_topology): both the nodes are active, as seen by
+ *         that LP. An LP knows only the status of its own SEs, the others are
+ *         active in its directory
  */
-void lunes_dot_tokenizer(char *buffer, int *source, int *destination) {
-    char *token;
-    int   i = 0;
-
-    token = strtok(buffer, "--");
-    do {
-        i++;
-
-        if (i == 1) {
-            *source = atoi(token);
-        }
-
-        if (i == 2) {
-            token[strlen(token) - 1] = '\0';
-            *destination             = atoi(token);
-        }
-    } while ((token = strtok(NULL, "--")));
+static int lunes_link_sent(context_t *ctx, hash_node_t *source_node, hash_node_t *destination_node) {
+    if (hash_lookup(ctx->stable, source_node->data->key)) {
+        return(SE_STATUS(ctx, destination_node) != 0 && SE_STATUS(ctx, source_node) != 0);
+    }
+    return(lunes_initial_status(ctx, source_node->data->key));
 }
 
-/*! \brief Parsing of graphviz dot files,
- *         used for loading the graphs (i.e. network topology)
+/*! \brief Loading the graphs (i.e. network topology) from graphviz dot files,
+ *         through their binary cache (see topology.c).
+ *         With BULK_LINKS the receivers of the links are updated by their own
+ *         LP, in a second pass over the edges, and no link message is sent
  */
-void lunes_load_graph_topology() {
-    FILE *dot_file;
-    char  buffer[1024];
-    int   source      = 0,
-          destination = 0;
+void lunes_load_graph_topology(context_t *ctx) {
+    char         buffer[1024];
+    topology_t   topo;
+    uint64_t     e;
+    int          source      = 0,
+                 destination = 0;
     hash_node_t *source_node,
                 *destination_node;
     value_element val;
-    // What's the file to read?
-    sprintf(buffer, "%s%s", TESTNAME, TOPOLOGY_GRAPH_FILE);
-    dot_file = fopen(buffer, "r");
+    // What's the file to read? The one of the context or the default one
+    if (ctx->graph[0] != '\0') {
+        snprintf(buffer, sizeof(buffer), "%s", ctx->graph);
+    }else {
+        sprintf(buffer, "%s%s", TESTNAME, TOPOLOGY_GRAPH_FILE);
+    }
+    topology_load(buffer, &topo, pool_workers());
 
     // Reading all of it
-    while (fgets(buffer, 1024, dot_file) != NULL) {
-        // Parsing line by line
-        lunes_dot_tokenizer(buffer, &source, &destination);
+    for (e = 0; e < topo.header->edges; e++) {
+        source      = topo.edge[e].source;
+        destination = topo.edge[e].destination;
 
         // I check all the edges defined in the dot file to build up "link messages"
         // between simulated entities in the simulated network model
 
         // Is the source node a valid simulated entity?
-        if ((source_node = hash_lookup(stable, source)))  {
+        if ((source_node = hash_lookup(ctx->stable, source)))  {
             // Is destination vertex a valid simulated entity?
-            if ((destination_node = hash_lookup(table, destination))) {
+            if ((destination_node = hash_lookup(ctx->table, destination))) {
 
-            	if (destination_node->data->status != 0 && source_node->data->status != 0){
+            	if (SE_STATUS(ctx, destination_node) != 0 && SE_STATUS(ctx, source_node) != 0){
 	                #ifdef AG_DEBUG
-	                fprintf(stdout, "%12.2f node: [%5d] adding link to [%5d]\n", simclock, source_node->data->key, destination_node->data->key);
+	                fprintf(stdout, "%12.2f node: [%5d] adding link to [%5d]\n", ctx->simclock, source_node->data->key, destination_node->data->key);
 	                #endif
 
 	                // Creating a link between simulated entities (i.e. sending a "link message" between them)
-	                execute_link(simclock + FLIGHT_TIME, source_node, destination_node);
+	                if (!env_bulk_links) {
+	                    execute_link(ctx, ctx->simclock + FLIGHT_TIME, source_node, destination_node);
+	                }
 
 	                // Initializing the extra data for the new neighbor
 	                val.value = destination;
+	                val.node  = destination_node;
 
 	                // I've to insert the new link (and its extra data) in the neighbor table of this sender,
 	                // the receiver will do the same when receiving the "link request" message
@@ -438,23 +616,45 @@ void lunes_load_graph_topology() {
 	                //	first entry	= key
 	                //	second entry	= value
 	                //	note: no duplicates are allowed
-	                if (add_entity_state_entry(destination, &val, source, source_node) == -1) {
+	                if (add_entity_state_entry(ctx, destination, &val, source, source_node) == -1) {
 	                    // Insertion aborted, the key is already in the hash table
-	                    fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] key %d (value %d) is a duplicate and can not be inserted in the hash table of local state\n", simclock, source, destination, destination);
+	                    fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] key %d (value %d) is a duplicate and can not be inserted in the hash table of local state\n", ctx->simclock, source, destination, destination);
 	                    fflush(stdout);
 	                    exit(-1);
 	                }
 	            }
 
             }else {
-                fprintf(stdout, "%12.2f FATAL ERROR, destination: %d does NOT exist!\n", simclock, destination);
+                fprintf(stdout, "%12.2f FATAL ERROR, destination: %d does NOT exist!\n", ctx->simclock, destination);
                 fflush(stdout);
                 exit(-1);
             }
         }
     }
 
-    fclose(dot_file);
+    // Bulk construction: each local destination adds the link, as if the "link messages"
+    // were received in the order of the file
+    for (e = 0; env_bulk_links && e < topo.header->edges; e++) {
+        source      = topo.edge[e].source;
+        destination = topo.edge[e].destination;
+
+        if ((destination_node = hash_lookup(ctx->stable, destination)) == NULL) {
+            continue;
+        }
+        if ((source_node = hash_lookup(ctx->table, source)) == NULL) {
+            fprintf(stdout, "%12.2f FATAL ERROR, source: %d does NOT exist!\n", ctx->simclock, source);
+            fflush(stdout);
+            exit(-1);
+        }
+        if (lunes_link_sent(ctx, source_node, destination_node)) {
+            user_link_event_handler(ctx, destination_node, source);
+        }
+    }
+
+    topology_release(&topo);
+
+    // All the links of the local SEs are now known, building the adjacency snapshot
+    csr_fold(ctx->csr, ctx->stable);
 }
 
 
@@ -468,220 +668,850 @@ int percentage_to_deactivate(int activate_perc){    //denominator = 10000
 }
 
 int count_neighbors (hash_node_t *node){
-	GHashTableIter iter;
-    gpointer       key, destination;
-	int count =0;
-	g_hash_table_iter_init(&iter, node->data->state);
-    while (g_hash_table_iter_next(&iter, &key, &destination)) {
-    	count++;
-    }	
-    return count;
+    return node->data->neighbors.count;
 }
 
 void print_neighbors (hash_node_t *node){
-	GHashTableIter iter;
-    gpointer       key, destination;
+    adj_row *      row = &node->data->neighbors;
+    unsigned int   i;
     hash_node_t *  neigh;
-	g_hash_table_iter_init(&iter, node->data->state);
-    while (g_hash_table_iter_next(&iter, &key, &destination)) {
-    	neigh = hash_lookup(table, *(unsigned int *)destination);
+    for (i = 0; i < row->count; i++) {
+    	neigh = row->record[i].elements.node;
     	fprintf(stdout, "%d,%d,0\n", node->data->key, neigh->data->key);
     }	
 }
 
 
-void attach_node (hash_node_t *node){
-	int connections = RND_Interval(S, 5,11); //how many connections to establish  #12-19 to get 12 edges per node, #5-11 to get 6 edges per node, #8-15 to get 9 edges per node
+void attach_node(context_t *ctx, hash_node_t *node){
+	int connections = rng_integer(&ctx->rng, node->data->key, (int)ctx->simclock, RNG_ATTACH, 5, 10); //how many connections to establish  #12-19 to get 12 edges per node, #5-11 to get 6 edges per node, #8-15 to get 9 edges per node
 	int count = 0;
 	while (count < connections){
-		int new_neighbor_id = RND_Interval(S, 0, (NLP*NSIMULATE)); // chose a random node of the graph
-		hash_node_t * new_neighbor = hash_lookup(table, new_neighbor_id); // The neighbor
-		if (new_neighbor_id != node->data->key && new_neighbor->data->status != 0){		
+		int new_neighbor_id = rng_integer(&ctx->rng, node->data->key, (int)ctx->simclock, RNG_ATTACH, 0, NLP*NSIMULATE - 1); // chose a random node of the graph
+		hash_node_t * new_neighbor = hash_lookup(ctx->table, new_neighbor_id); // The neighbor
+		if (new_neighbor_id != node->data->key && SE_STATUS(ctx, new_neighbor) != 0){		
 			value_element val;
 		    val.value = new_neighbor_id;	
+		    val.node  = new_neighbor;
 		    #ifdef HIERARCHY
-			int prob = RND_Interval(S, 0, (400)); // chose a random node of the graph
-			if((prob < 160 && simclock < 400) || prob < 80){
+			int prob = rng_integer(&ctx->rng, node->data->key, (int)ctx->simclock, RNG_ATTACH, 0, 399); // chose a random node of the graph
+			if((prob < 160 && ctx->simclock < WARMUP_STEPS) || prob < 80){
 				new_neighbor_id = prob % 80;
-				new_neighbor = hash_lookup(table, new_neighbor_id);
+				new_neighbor = hash_lookup(ctx->table, new_neighbor_id);
 				val.value = new_neighbor_id;	
+				val.node  = new_neighbor;
 			}
 		    #endif
-		    if (add_entity_state_entry(new_neighbor_id, &val, node->data->key, node) != -1) {
-		    	execute_link(simclock + FLIGHT_TIME, node, new_neighbor);
+		    if (add_entity_state_entry(ctx, new_neighbor_id, &val, node->data->key, node) != -1) {
+		    	execute_link(ctx, ctx->simclock + FLIGHT_TIME, node, new_neighbor);
 		    	count++;
             }
 		}
 	}
-	node->data->num_neighbors = connections;
+	SE_NUM_NEIGHBORS(ctx, node) = connections;
 }  
 
 
-void detach_node (hash_node_t *node){
-	GHashTableIter iter;
-    gpointer       key, destination;
+void detach_node(context_t *ctx, hash_node_t *node){
+    adj_row *      row = &node->data->neighbors;
+    unsigned int   i;
     hash_node_t *  toDel;
 
-	g_hash_table_iter_init(&iter, node->data->state);
-    while (g_hash_table_iter_next(&iter, &key, &destination)) {
-    	toDel = hash_lookup(table, *(unsigned int *)destination);   // The neighbor
-    	execute_unlink(simclock + FLIGHT_TIME, node, toDel);		// To signal that node has deactivated so the link is broken
-    	execute_unlink(simclock + FLIGHT_TIME, toDel, node) ;       //link will be actually removed at the next step
+    for (i = 0; i < row->count; i++) {
+    	toDel = row->record[i].elements.node;                       // The neighbor
+    	execute_unlink(ctx, ctx->simclock + FLIGHT_TIME, node, toDel);		// To signal that node has deactivated so the link is broken
+    	execute_unlink(ctx, ctx->simclock + FLIGHT_TIME, toDel, node) ;       //link will be actually removed at the next step
     }	
-    node->data->num_neighbors = 0;
+    SE_NUM_NEIGHBORS(ctx, node) = 0;
 } 
 
 
 
+/*! \brief Name of an output file of a context: for the LP, its replica (see
+ *         REPLICAS) or a configuration of the sweep (see SWEEP)
+ */
+static void lunes_output_name(context_t *ctx, const char *kind, const char *extension, char *name, size_t size) {
+	if (env_replicas > 0) {
+		snprintf(name, size, "%s%s_%03d_REPLICA_%02d.%s", TESTNAME, kind, LPID, ctx->replica, extension);
+	}else if (ctx->model->configuration > 0) {
+		snprintf(name, size, "%s%s_%03d_SWEEP_%02d.%s", TESTNAME, kind, LPID, ctx->model->configuration, extension);
+	}else {
+		snprintf(name, size, "%s%s_%03d.%s", TESTNAME, kind, LPID, extension);
+	}
+}
+
+/*! \brief Opens the metrics stream of a context, a new one or, "resume", the
+ *         one of the interrupted run (see lunes_user_checkpoint_restore_handler())
+ */
+static void lunes_metrics_open(context_t *ctx, int resume) {
+	metrics_header header;
+	char           name[1024];
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, METRICS_MAGIC, sizeof(header.magic));
+	header.version     = METRICS_VERSION;
+	header.record_size = sizeof(metrics_record);
+	header.lp          = LPID;
+	header.lps         = NLP;
+	header.entities    = NSIMULATE;
+	header.max_ttl     = env_max_ttl;
+	header.lookups     = env_lookups;
+	header.replica     = env_replicas > 0 ? ctx->replica : ctx->model->configuration;
+
+	lunes_output_name(ctx, "METRICS", "dat", name, sizeof(name));
+	if (resume) {
+		metrics_resume(ctx->model->metrics, name, &header, ctx->model->epoch.epoch);
+	}
+	else {
+		metrics_create(ctx->model->metrics, name, &header);
+	}
+}
+
+/*! \brief Histograms of the run: the hops of the deliveries (merged from the
+ *         workers) and the requests received by each local node
+ */
+static void lunes_histograms(context_t *ctx, histogram_t *hops, histogram_t *load) {
+	int w, h;
+
+	histogram_init(hops);
+	histogram_init(load);
+	for (w = 0; w < pool_workers(); w++) {
+		histogram_merge(hops, &ctx->model->worker_data[w].hops);
+	}
+	for (h = 0; h < ctx->stable->count; h++) {
+		histogram_record(load, ctx->model->load[ctx->stable->node[h].data->key]);
+	}
+}
+
+/*! \brief Writes the buckets of the histograms of the run, those of many LPs
+ *         can be merged (see histogram.c)
+ */
+static void lunes_histograms_dump(context_t *ctx) {
+	histogram_t *histogram;
+	char         name[1024];
+	FILE *       out;
+
+	histogram = (histogram_t *)malloc(2 * sizeof(histogram_t));
+	ASSERT((histogram != NULL), ("lunes_histograms_dump: malloc error"));
+	lunes_histograms(ctx, &histogram[0], &histogram[1]);
+
+	lunes_output_name(ctx, "HISTOGRAMS", "txt", name, sizeof(name));
+	if ((out = fopen(name, "w")) == NULL) {
+		fprintf(stdout, "%12.2f FATAL ERROR, impossible to create the histograms file %s\n", ctx->simclock, name);
+		fflush(stdout);
+		exit(-1);
+	}
+	fprintf(out, "# histogram lower upper count\n");
+	histogram_dump(out, "hops", &histogram[0]);
+	histogram_dump(out, "load", &histogram[1]);
+	fclose(out);
+
+	free(histogram);
+}
+
+/*! \brief Merges the statistics of the workers in the record of the current
+ *         epoch, they start again from zero
+ */
+static void lunes_metrics_merge(context_t *ctx) {
+	metrics_record *record = &ctx->model->epoch, *epoch;
+	int             w;
+
+	for (w = 0; w < pool_workers(); w++) {
+		epoch = &ctx->model->worker_data[w].epoch;
+		record->messages += epoch->messages;
+		record->delivers += epoch->delivers;
+		record->hops     += epoch->hops;
+		record->covered  += epoch->covered;
+		memset(epoch, 0, sizeof(metrics_record));
+	}
+}
+
+/*! \brief The current epoch is complete: its record goes in the metrics stream
+ *         (if any) and a new one is started
+ */
+static void lunes_metrics_complete(context_t *ctx) {
+	lunes_metrics_merge(ctx);
+	if (ctx->model->epoch.epoch >= 0 && ctx->model->metrics != NULL) {
+		metrics_append(ctx->model->metrics, &ctx->model->epoch);
+	}
+	memset(&ctx->model->epoch, 0, sizeof(metrics_record));
+	ctx->model->epoch.epoch = -1;
+}
+
+/****************************************************************************
+ *! \brief LUNES_EPOCH: at the beginning of each epoch the hot fields of all the
+ *         local nodes are updated and their lookups are reset. The scans run over
+ *         the arrays of the global directory, the local nodes are selected by a mask
+ */
+void lunes_user_epoch_handler(context_t *ctx) {
+    unsigned char * status        = ctx->table->status;
+    unsigned short *num_neighbors = ctx->table->num_neighbors;
+    int *           slot          = ctx->stable->slot;
+    int             h, k, id, local, links = 0, active = 0;
+    hash_node_t *   node;
+    RequestMsg      msg;
+
+    if (ctx->simclock == env_max_ttl){						//just once: counting neighbors
+        for (h = 0; h < ctx->stable->count; h++) {
+            node = &ctx->stable->node[h];
+            SE_NUM_NEIGHBORS(ctx, node) = node->data->neighbors.count;
+        }
+    }
+
+    g_array_set_size(ctx->model->stem_watch, 0);
+    for (h = 0; h < pool_workers(); h++) {
+        g_array_set_size(ctx->model->worker_data[h].stem, 0);
+    }
+    for (id = 0; id < ctx->table->keys; id++) {
+        local = (slot[id] != -1);
+
+        links  += local ? num_neighbors[id] : 0;                                // temp to delete
+        active += local & (status[id] != 0);
+    }
+    ctx->model->tempcountLinks  += links;
+    ctx->model->tempcountActive += active;
+
+    // The previous epoch is complete: all its messages have been delivered
+    lunes_metrics_complete(ctx);
+    ctx->model->epoch.epoch  = (int)ctx->simclock / env_max_ttl;
+    ctx->model->epoch.active = active;
+    ctx->model->epoch.links  = links;
+
+    // The caches do not need a reset: the messages of the new lookups have new identifiers
+    for (k = 0; k < env_lookups; k++) {
+        ctx->model->lookup_holder[k]    = LOOKUP_HOLDER;
+        ctx->model->lookup_applicant[k] = LOOKUP_APPLICANT;
+    }
+
+    for (k = 0; k < env_lookups; k++) {
+        if ((node = hash_lookup(ctx->stable, ctx->applicant[k]))) {
+
+        	if (ctx->simclock > WARMUP_STEPS){    // > WARMUP_STEPS because one waits the network to stabilize
+        		ctx->countEpochs++;
+        		ctx->model->lookup_started[k]++;
+        		ctx->model->epoch.lookups++;
+        		if (env_dissemination_mode != DANDELIONPLUS && env_dissemination_mode != DANDELION &&  env_dissemination_mode != DANDELIONPLUSPLUS){
+        			lunes_send_request_to_neighbors(ctx, node, lunes_lookup_id(ctx, k));
+        			lunes_set_received(ctx, node, lunes_lookup_id(ctx, k), (int)ctx->simclock);
+        		} else{
+                    // Defining the message type (only the request is built, not the whole Msg union)
+                    memset(&msg, 0, REQUEST_MSG_SIZE);
+                    msg.request_static.type      = 'R';
+                    msg.request_static.version   = MSG_VERSION;
+                    msg.request_static.timestamp = ctx->simclock;
+                    msg.request_static.ttl       = env_max_ttl;
+                    msg.request_static.id        = lunes_lookup_id(ctx, k);
+                    msg.request_static.creator   = node->data->key;
+        			lunes_forward_to_neighbors(ctx, node, (Msg *)&msg, --(msg.request_static.ttl), ctx->simclock, msg.request_static.id, msg.request_static.creator, node->data->key);                            
+        			lunes_set_received(ctx, node, msg.request_static.id, (int)ctx->simclock);				//for Dandelion++
+        		}
+        	}
+        }
+    }
+}
+
+/*! \brief Initialization of the model level data structures of a context
+ */
+void lunes_user_bootstrap_handler(context_t *ctx) {
+	int    w;
+	size_t i;
+
+	ctx->model = (struct lunes_model *)calloc(1, sizeof(struct lunes_model));
+	ASSERT((ctx->model != NULL), ("lunes_user_bootstrap_handler: malloc error"));
+
+	calendar_init(&ctx->model->churn_calendar, CHURN_CALENDAR_SIZE);
+	ctx->model->churn_due      = g_array_new(FALSE, FALSE, sizeof(int));
+	ctx->model->churn_actions  = g_array_new(FALSE, FALSE, sizeof(churn_action));
+	ctx->model->isolated_watch = g_array_new(FALSE, FALSE, sizeof(int));
+	ctx->model->stem_watch     = g_array_new(FALSE, FALSE, sizeof(int));
+
+	ctx->model->seen_cache = (seen_entry *)malloc((size_t)ctx->table->keys * env_cache_size * sizeof(seen_entry));
+	ctx->model->seen_next  = (unsigned short *)calloc(ctx->table->keys, sizeof(unsigned short));
+	ctx->model->load       = (unsigned int *)calloc(ctx->table->keys, sizeof(unsigned int));
+	ASSERT((ctx->model->seen_cache != NULL && ctx->model->seen_next != NULL && ctx->model->load != NULL), ("lunes_user_bootstrap_handler: malloc error"));
+	for (i = 0; i < (size_t)ctx->table->keys * env_cache_size; i++) {
+		ctx->model->seen_cache[i].id = -1;
+	}
+
+	if (posix_memalign((void **)&ctx->model->worker_data, POOL_ALIGN, sizeof(lunes_worker_t) * pool_workers()) != 0) {
+		ctx->model->worker_data = NULL;
+	}
+	ASSERT((ctx->model->worker_data != NULL), ("lunes_user_bootstrap_handler: malloc error"));
+	for (w = 0; w < pool_workers(); w++) {
+		memset(&ctx->model->worker_data[w], 0, sizeof(lunes_worker_t));
+		ctx->model->worker_data[w].isolated = g_array_new(FALSE, FALSE, sizeof(int));
+		ctx->model->worker_data[w].stem     = g_array_new(FALSE, FALSE, sizeof(int));
+		histogram_init(&ctx->model->worker_data[w].hops);
+	}
+
+	ctx->model->epoch.epoch = -1;
+	if (env_metrics) {
+		ctx->model->metrics = (metrics_t *)malloc(sizeof(metrics_t));
+		ASSERT((ctx->model->metrics != NULL), ("lunes_user_bootstrap_handler: malloc error"));
+		ctx->model->metrics->file = NULL;
+		// Resuming a run, the stream of the interrupted run is opened with the checkpoint
+		if (env_restore == 0) {
+			lunes_metrics_open(ctx, 0);
+		}
+	}
+}
+
+/*! \brief A configuration of the sweep goes on in a forked process (see
+ *         t_graph.c), with its own metrics stream
+ */
+void lunes_user_sweep_handler(context_t *ctx, int configuration) {
+	ctx->model->configuration = configuration;
+	if (configuration > 0 && ctx->model->metrics != NULL) {
+		metrics_discard(ctx->model->metrics);
+		lunes_metrics_open(ctx, 0);
+	}
+}
+
+/*! \brief Sums up the statistics of the workers, with more than a lookup in
+ *         each epoch the deliveries of each of them are reported too (in "out")
+ */
+void lunes_user_statistics_handler(context_t *ctx, FILE *out) {
+	histogram_t *histogram;
+	int          w, k, delivers;
+
+	for (w = 0; w < pool_workers(); w++) {
+		ctx->countMessages += ctx->model->worker_data[w].messages;
+		ctx->countDelivers += ctx->model->worker_data[w].delivers;
+		ctx->countSteps    += ctx->model->worker_data[w].steps;
+	}
+
+	if (env_lookups > 1) {
+		for (k = 0; k < env_lookups; k++) {
+			for (w = 0, delivers = 0; w < pool_workers(); w++) {
+				delivers += ctx->model->worker_data[w].lookup_delivers[k];
+			}
+			fprintf(out, "Lookup %2d: message received %d times in %d simulations\n", k, delivers, ctx->model->lookup_started[k]);
+		}
+	}
+
+	// Tails of the hops and of the load of the nodes
+	histogram = (histogram_t *)malloc(2 * sizeof(histogram_t));
+	ASSERT((histogram != NULL), ("lunes_user_statistics_handler: malloc error"));
+	lunes_histograms(ctx, &histogram[0], &histogram[1]);
+	histogram_summary(out, "Hops to the holder", &histogram[0]);
+	histogram_summary(out, "Requests per node", &histogram[1]);
+	free(histogram);
+}
+
+/*! \brief Releases the model level data structures of a context
+ */
+void lunes_user_shutdown_handler(context_t *ctx) {
+	int w;
+
+	// The last epoch ends with the run
+	lunes_metrics_complete(ctx);
+	if (ctx->model->metrics != NULL) {
+		metrics_close(ctx->model->metrics);
+		free(ctx->model->metrics);
+	}
+	lunes_histograms_dump(ctx);
+
+	for (w = 0; w < pool_workers(); w++) {
+		g_array_free(ctx->model->worker_data[w].isolated, TRUE);
+		g_array_free(ctx->model->worker_data[w].stem, TRUE);
+	}
+	free(ctx->model->worker_data);
+	free(ctx->model->seen_cache);
+	free(ctx->model->seen_next);
+	free(ctx->model->load);
+
+	calendar_free(&ctx->model->churn_calendar);
+	g_array_free(ctx->model->churn_due, TRUE);
+	g_array_free(ctx->model->churn_actions, TRUE);
+	g_array_free(ctx->model->isolated_watch, TRUE);
+	g_array_free(ctx->model->stem_watch, TRUE);
+
+	free(ctx->model);
+	ctx->model = NULL;
+}
+
+/*! \brief Writes the model state of the local nodes in a checkpoint (see
+ *         t_graph.c): caches, progress of the lookups, churn calendar and the
+ *         statistics. The data of the workers is merged, a run can be resumed
+ *         with any number of them
+ */
+void lunes_user_checkpoint_save_handler(context_t *ctx, checkpoint_t *ck) {
+	lunes_worker_t  total;
+	GArray *        events;
+	hash_node_t *   node;
+	uint32_t        length;
+	int             w, k, h;
+
+	// The records of the metrics stream written so far must be on disk with the checkpoint
+	if (ctx->model->metrics != NULL) {
+		metrics_flush(ctx->model->metrics);
+	}
+
+	checkpoint_put(ck, &ctx->model->tempcountLinks, sizeof(ctx->model->tempcountLinks));
+	checkpoint_put(ck, &ctx->model->tempcountActive, sizeof(ctx->model->tempcountActive));
+	checkpoint_put(ck, ctx->model->lookup_applicant, sizeof(unsigned char) * env_lookups);
+	checkpoint_put(ck, ctx->model->lookup_holder, sizeof(unsigned char) * env_lookups);
+	checkpoint_put(ck, ctx->model->lookup_started, sizeof(int) * env_lookups);
+
+	memset(&total, 0, sizeof(total));
+	for (w = 0; w < pool_workers(); w++) {
+		total.messages += ctx->model->worker_data[w].messages;
+		total.delivers += ctx->model->worker_data[w].delivers;
+		total.steps    += ctx->model->worker_data[w].steps;
+		for (k = 0; k < env_lookups; k++) {
+			total.lookup_delivers[k] += ctx->model->worker_data[w].lookup_delivers[k];
+		}
+	}
+	checkpoint_put(ck, &total.messages, sizeof(total.messages));
+	checkpoint_put(ck, &total.delivers, sizeof(total.delivers));
+	checkpoint_put(ck, &total.steps, sizeof(total.steps));
+	checkpoint_put(ck, total.lookup_delivers, sizeof(int) * env_lookups);
+
+	// Record of the current epoch, the workers included
+	lunes_metrics_merge(ctx);
+	checkpoint_put(ck, &ctx->model->epoch, sizeof(metrics_record));
+
+	// Histogram of the hops, merged, and load of the local nodes
+	histogram_init(&total.hops);
+	for (w = 0; w < pool_workers(); w++) {
+		histogram_merge(&total.hops, &ctx->model->worker_data[w].hops);
+	}
+	checkpoint_put(ck, &total.hops, sizeof(histogram_t));
+
+	// Caches of the local nodes
+	for (h = 0; h < ctx->stable->count; h++) {
+		node = &ctx->stable->node[h];
+		checkpoint_put(ck, &node->data->key, sizeof(int));
+		checkpoint_put(ck, &ctx->model->seen_next[node->data->key], sizeof(unsigned short));
+		checkpoint_put(ck, &ctx->model->seen_cache[(size_t)node->data->key * env_cache_size], sizeof(seen_entry) * env_cache_size);
+		checkpoint_put(ck, &ctx->model->load[node->data->key], sizeof(unsigned int));
+	}
+
+	// Scheduled changes of activity, the order in a bucket does not matter (see calendar_pop())
+	events = g_array_sized_new(FALSE, FALSE, sizeof(calendar_event), ctx->model->churn_calendar.count);
+	for (h = 0; h < ctx->model->churn_calendar.size; h++) {
+		g_array_append_vals(events, ctx->model->churn_calendar.bucket[h]->data, ctx->model->churn_calendar.bucket[h]->len);
+	}
+	checkpoint_put_array(ck, events);
+	g_array_free(events, TRUE);
+
+	// Nodes to visit, those found by the workers are merged (and sorted) later anyway
+	checkpoint_put_array(ck, ctx->model->isolated_watch);
+	checkpoint_put_array(ck, ctx->model->stem_watch);
+	for (k = 0; k < 2; k++) {
+		for (w = 0, length = 0; w < pool_workers(); w++) {
+			length += k ? ctx->model->worker_data[w].stem->len : ctx->model->worker_data[w].isolated->len;
+		}
+		checkpoint_put(ck, &length, sizeof(length));
+		for (w = 0; w < pool_workers(); w++) {
+			events = k ? ctx->model->worker_data[w].stem : ctx->model->worker_data[w].isolated;
+			checkpoint_put(ck, events->data, sizeof(int) * events->len);
+		}
+	}
+}
+
+/*! \brief Reads the model state written by lunes_user_checkpoint_save_handler(),
+ *         the statistics and the nodes found by the workers go to the first one
+ */
+void lunes_user_checkpoint_restore_handler(context_t *ctx, checkpoint_t *ck) {
+	GArray *       events;
+	calendar_event event;
+	uint32_t       length;
+	int            w, h, key;
+	guint          i;
+
+	checkpoint_get(ck, &ctx->model->tempcountLinks, sizeof(ctx->model->tempcountLinks));
+	checkpoint_get(ck, &ctx->model->tempcountActive, sizeof(ctx->model->tempcountActive));
+	checkpoint_get(ck, ctx->model->lookup_applicant, sizeof(unsigned char) * env_lookups);
+	checkpoint_get(ck, ctx->model->lookup_holder, sizeof(unsigned char) * env_lookups);
+	checkpoint_get(ck, ctx->model->lookup_started, sizeof(int) * env_lookups);
+
+	for (w = 0; w < pool_workers(); w++) {
+		ctx->model->worker_data[w].messages = 0;
+		ctx->model->worker_data[w].delivers = 0;
+		ctx->model->worker_data[w].steps    = 0;
+		memset(ctx->model->worker_data[w].lookup_delivers, 0, sizeof(ctx->model->worker_data[w].lookup_delivers));
+		memset(&ctx->model->worker_data[w].epoch, 0, sizeof(metrics_record));
+		histogram_init(&ctx->model->worker_data[w].hops);
+		g_array_set_size(ctx->model->worker_data[w].isolated, 0);
+		g_array_set_size(ctx->model->worker_data[w].stem, 0);
+	}
+	checkpoint_get(ck, &ctx->model->worker_data[0].messages, sizeof(ctx->model->worker_data[0].messages));
+	checkpoint_get(ck, &ctx->model->worker_data[0].delivers, sizeof(ctx->model->worker_data[0].delivers));
+	checkpoint_get(ck, &ctx->model->worker_data[0].steps, sizeof(ctx->model->worker_data[0].steps));
+	checkpoint_get(ck, ctx->model->worker_data[0].lookup_delivers, sizeof(int) * env_lookups);
+	checkpoint_get(ck, &ctx->model->epoch, sizeof(metrics_record));
+	checkpoint_get(ck, &ctx->model->worker_data[0].hops, sizeof(histogram_t));
+
+	for (h = 0; h < ctx->stable->count; h++) {
+		checkpoint_get(ck, &key, sizeof(int));
+		if (hash_lookup(ctx->stable, key) == NULL) {
+			fprintf(stdout, "%12.2f FATAL ERROR, [%5d] in the checkpoint is not a local node\n", ctx->simclock, key);
+			fflush(stdout);
+			exit(-1);
+		}
+		checkpoint_get(ck, &ctx->model->seen_next[key], sizeof(unsigned short));
+		checkpoint_get(ck, &ctx->model->seen_cache[(size_t)key * env_cache_size], sizeof(seen_entry) * env_cache_size);
+		checkpoint_get(ck, &ctx->model->load[key], sizeof(unsigned int));
+	}
+
+	for (h = 0; h < ctx->model->churn_calendar.size; h++) {
+		g_array_set_size(ctx->model->churn_calendar.bucket[h], 0);
+	}
+	ctx->model->churn_calendar.count = 0;
+	events = g_array_new(FALSE, FALSE, sizeof(calendar_event));
+	checkpoint_get_array(ck, events);
+	for (i = 0; i < events->len; i++) {
+		event = g_array_index(events, calendar_event, i);
+		calendar_insert(&ctx->model->churn_calendar, event.step, event.key);
+	}
+	g_array_free(events, TRUE);
+
+	checkpoint_get_array(ck, ctx->model->isolated_watch);
+	checkpoint_get_array(ck, ctx->model->stem_watch);
+	checkpoint_get(ck, &length, sizeof(length));
+	g_array_set_size(ctx->model->worker_data[0].isolated, length);
+	checkpoint_get(ck, ctx->model->worker_data[0].isolated->data, sizeof(int) * length);
+	checkpoint_get(ck, &length, sizeof(length));
+	g_array_set_size(ctx->model->worker_data[0].stem, length);
+	checkpoint_get(ck, ctx->model->worker_data[0].stem->data, sizeof(int) * length);
+
+	// The metrics stream goes on after the records of the epochs completed before the checkpoint
+	if (ctx->model->metrics != NULL) {
+		lunes_metrics_open(ctx, 1);
+	}
+}
+
 /****************************************************************************
- *! \brief LUNES_CONTROL: node activity for the current timestep
+ *! \brief LUNES_CONTROL: initial activity of a node (at the building step)
  * @param[in] node: Node that execute actions
  */
-void lunes_user_control_handler(hash_node_t *node) {
+void lunes_user_control_handler(context_t *ctx, hash_node_t *node) {
 	#ifdef HIERARCHY
 	if (node->data->key >80){
 	#endif
 
-	if (simclock == BUILDING_STEP){						//just once: Building graph topology
-		int rnd = RND_Interval(S, 0, 100);
-		if (rnd >= env_perc_active_nodes_){
-			node->data->status = 0;
+	if (ctx->simclock == BUILDING_STEP){						//just once: Building graph topology
+		if (!lunes_initial_status(ctx, node->data->key)){
+			SE_STATUS(ctx, node) = 0;
 		}
 	}	
 			
 	#ifdef HIERARCHY
 	}
 	#endif
-	/*
-	if ((int)simclock % 10000 == 0 && node->data->status != 0 && node->data->key < 80){
-		fprintf(stdout, "at %f node %d has %d\n", simclock, node->data->key, node->data->num_neighbors );
-	}*/
-	
-
-    if (simclock == env_max_ttl){						//just once: counting neighbors
-		GHashTableIter iter;
-	    gpointer       key, destination;
-	    g_hash_table_iter_init(&iter, node->data->state);
-	    int count = 0;
-	        // All neighbors
-	    while (g_hash_table_iter_next(&iter, &key, &destination)) {
-	        count = count +1;
-	    }
-	    node->data->num_neighbors = count;
-    }
+}
 
-    if (node->data->status != 0 && node->data->num_neighbors == 0 && simclock > env_max_ttl){
-    	attach_node (node);
-    }
+/*! \brief Status of a node after the building step (1 active, 0 not active): it
+ *         is drawn from the stream of the node, all the LPs can compute it
+ */
+int lunes_initial_status(context_t *ctx, int key) {
+	#ifdef HIERARCHY
+	if (key <= 80){
+		return(1);
+	}
+	#endif
+	return(rng_integer(&ctx->rng, key, BUILDING_STEP, RNG_BUILD, 0, 99) < env_perc_active_nodes_);
+}
 
+/*! \brief Number of timesteps up to the first success of a Bernoulli trial with
+ *         probability p repeated at each timestep (geometric distribution),
+ *         -1 if it does not happen before the end of the simulation
+ */
+int lunes_churn_delay(context_t *ctx, hash_node_t *node, double p) {
+	double u;
+	double delay;
 
-    
-    if ((int) simclock % env_max_ttl == 0 && (int)simclock >= env_max_ttl) {  		// at the beginnning of each epoch
-    	//if (node->data->status > 0){
-    	tempcountLinks = tempcountLinks + node->data->num_neighbors;   				// temp to delete
-    	tempcountActive = (node->data->status != 0) ? tempcountActive + 1 : tempcountActive;
-        //}
-    	node->data->received = 0;
-
-    	if (node->data->status != 0){
-    		node->data->status = 1;
-    	}
-    	if (node->data->key == applicant){
-    		node->data->status = 2;
-    	}
-    	if (node->data->key == holder){
-    		node->data->status = 3;
-    	}
-
-    	if (node->data->key == applicant && simclock > 400){    // > 400 because one waits the network to stabilize
-    		countEpochs++;
-    		if (env_dissemination_mode != DANDELIONPLUS && env_dissemination_mode != DANDELION &&  env_dissemination_mode != DANDELIONPLUSPLUS){
-    			lunes_send_request_to_neighbors(node, 0);
-    			node->data->received = (int)simclock;
-    		} else{
-    			RequestMsg     msg;
-                // Defining the message type
-                msg.request_static.type = 'R';
-                msg.request_static.timestamp = simclock;
-                msg.request_static.ttl       = env_max_ttl;
-                msg.request_static.creator   = node->data->key;
-                Msg m = (Msg) msg;
-    			lunes_forward_to_neighbors(node, &m, --(msg.request_static.ttl), simclock, 0, msg.request_static.creator, node->data->key);                            
-    			node->data->received = (int)simclock;				//for Dandelion++
-    		}
-    	}
-	}
-
-	if ((int)simclock > env_max_ttl) {							// at each step there is the chance for a node to activate or deactivate 
-		int rnd = RND_Interval(S, 0, 10000);
-		if (node->data->status == 0){               
-			if (rnd < 100){                        				//1% for an off node to activate
-				node->data->status = 1;
-				attach_node(node);
-			}
+	if (p <= 0) {
+		return(-1);
+	}
+	if (p >= 1) {
+		return(1);
+	}
+
+	u     = rng_uniform(&ctx->rng, node->data->key, (int)ctx->simclock, RNG_CHURN);
+	delay = ceil(log(u) / log(1.0 - p));
+	if (delay > env_end_clock) {
+		return(-1);
+	}
+
+	return(delay < 1 ? 1 : (int)delay);
+}
+
+/*! \brief Timestep of the next change of activity of a node (-1 none): the trials
+ *         start at the next timestep, 1% for an off node to activate and
+ *         percentage_to_deactivate(100) / 10000 for an active one to deactivate
+ */
+int lunes_churn_next(context_t *ctx, hash_node_t *node) {
+	double p;
+	int    delay;
+
+	if (SE_STATUS(ctx, node) == 0) {
+		p = 100 / 10000.0;
+	}
+	else {
+		p = percentage_to_deactivate(100) / 10000.0;
+	}
+
+	if ((delay = lunes_churn_delay(ctx, node, p)) == -1) {
+		return(-1);
+	}
+	return((int)ctx->simclock + delay);
+}
+
+/*! \brief Marks an active node without neighbors, it will be attached in the
+ *         control phase of the current timestep
+ */
+void lunes_watch_isolated(context_t *ctx, hash_node_t *node) {
+	if (SE_STATUS(ctx, node) != 0 && SE_NUM_NEIGHBORS(ctx, node) == 0) {
+		g_array_append_val(ctx->model->worker_data[pool_worker()].isolated, node->data->key);
+	}
+}
+
+static gint lunes_compare_keys(gconstpointer a, gconstpointer b) {
+	return(*(const int *)a - *(const int *)b);
+}
+
+/*! \brief Moves the IDs found by the workers in "list", sorted and without
+ *         duplicates: the result does not depend on the number of workers
+ */
+static void lunes_merge_watch(context_t *ctx, GArray *list, int stem) {
+	GArray *found;
+	guint   i, kept;
+	int     w;
+
+	for (w = 0; w < pool_workers(); w++) {
+		found = stem ? ctx->model->worker_data[w].stem : ctx->model->worker_data[w].isolated;
+		g_array_append_vals(list, found->data, found->len);
+		g_array_set_size(found, 0);
+	}
+	g_array_sort(list, lunes_compare_keys);
+
+	for (i = 0, kept = 0; i < list->len; i++) {
+		if (kept == 0 || g_array_index(list, int, i) != g_array_index(list, int, kept - 1)) {
+			g_array_index(list, int, kept++) = g_array_index(list, int, i);
 		}
-		else if (node->data->status == 1 || node->data->status == 5){    
-		#ifdef HIERARCHY 
-		if (node->data->key>=80){
-		#endif     
-			if (rnd < percentage_to_deactivate (100)){
-				node->data->status = 0;
-				detach_node(node);
-			}
-		#ifdef HIERARCHY
+	}
+	g_array_set_size(list, kept);
+}
+
+/*! \brief Worker task, first part of the churn: the nodes with a scheduled change
+ *         update their own status and draw the next change. The status of the
+ *         other nodes is only read in the second part
+ */
+static void lunes_churn_transition_task(int first, int last, void *arg) {
+	context_t *   ctx    = (context_t *)arg;
+	churn_action *action = (churn_action *)ctx->model->churn_actions->data;
+	hash_node_t * node;
+	int           i;
+
+	for (i = first; i < last; i++) {
+		if (!action[i].due || (node = hash_lookup(ctx->stable, action[i].key)) == NULL) {
+			continue;										// only isolated, or migrated
+		}
+		if (SE_STATUS(ctx, node) == 0) {
+			SE_STATUS(ctx, node)  = 1;
+			action[i].action = CHURN_ATTACH;
 		}
+		else if (!lunes_lookup_role(ctx, node)
+		#ifdef HIERARCHY
+		&& node->data->key >= 80
 		#endif
+		) {
+			SE_STATUS(ctx, node)  = 0;
+			action[i].action = CHURN_DETACH;
+			lunes_clear_seen(ctx, node);
 		}
+		// else the node can not deactivate now (e.g. applicant or holder): the
+		// trials are memoryless, a new delay is drawn from the next timestep
+		action[i].next = lunes_churn_next(ctx, node);
 	}
+}
 
+/*! \brief Worker task, second part of the churn: links of the activated,
+ *         deactivated and isolated nodes
+ */
+static void lunes_churn_link_task(int first, int last, void *arg) {
+	context_t *   ctx    = (context_t *)arg;
+	churn_action *action = (churn_action *)ctx->model->churn_actions->data;
+	hash_node_t * node;
+	int           i;
+
+	for (i = first; i < last; i++) {
+		if ((node = hash_lookup(ctx->stable, action[i].key)) == NULL) {
+			continue;
+		}
+		if (action[i].action == CHURN_DETACH) {
+			detach_node(ctx, node);
+		}
+		else if (action[i].action == CHURN_ATTACH ||
+		         (action[i].isolated && SE_STATUS(ctx, node) != 0 && SE_NUM_NEIGHBORS(ctx, node) == 0)) {
+			attach_node(ctx, node);
+		}
+	}
+}
+
+/*! \brief Worker task: dandelion++ recovery mechanism, nodes that received the message in the stem phase
+ *         start the fluff phase if they don't receive the message back in time. The candidates
+ *         (node and lookup, see LOOKUP_INDEX) that are no longer such are marked with -1
+ */
+static void lunes_recovery_task(int first, int last, void *arg) {
+	context_t *  ctx       = (context_t *)arg;
+	int *        candidate = (int *)ctx->model->stem_watch->data;
+	hash_node_t *node;
+	int          i, k, received;
+
+	for (i = first; i < last; i++) {
+		k = candidate[i] % env_lookups;
+		if ((node = hash_lookup(ctx->stable, candidate[i] / env_lookups)) == NULL || (received = lunes_get_received(ctx, node, lunes_lookup_id(ctx, k))) <= 0) {
+			candidate[i] = -1;
+			continue;
+		}
+		if ((env_dissemination_mode == DANDELIONPLUS  && received > 0 && ctx->simclock > WARMUP_STEPS && SE_STATUS(ctx, node) !=0 &&                      //DANDELIONPLUS
+		   ctx->simclock - received > env_dandelion_stem_steps + 4 && received % env_max_ttl <= env_dandelion_stem_steps) ||
+			(env_dissemination_mode == DANDELIONPLUSPLUS  && received > 0 && ctx->simclock > WARMUP_STEPS && SE_STATUS(ctx, node) !=0 &&                      //DANDELION++
+		   ctx->simclock - received > 7 && received % env_max_ttl <= env_dandelion_stem_steps && is_in_stem_mode(ctx, node)==1 )){         
+			RequestMsg     msg;
+	        memset(&msg, 0, REQUEST_MSG_SIZE);
+	        msg.request_static.type      = 'R';
+	        msg.request_static.version   = MSG_VERSION;
+	        msg.request_static.timestamp = ctx->simclock;
+	        msg.request_static.ttl       = env_max_ttl - ((int)ctx->simclock % env_max_ttl);
+	        msg.request_static.id        = lunes_lookup_id(ctx, k);
+	        msg.request_static.creator   = node->data->key;
+			lunes_forward_to_neighbors(ctx, node, (Msg *)&msg, --(msg.request_static.ttl), ctx->simclock, msg.request_static.id, msg.request_static.creator, node->data->key);                            
+			
+			lunes_set_received(ctx, node, msg.request_static.id, -1);
+			candidate[i] = -1;
+		}
+	}
+}
+
+/*! \brief Activity of the nodes in the current timestep: only the nodes that
+ *         change state, the isolated ones and those that could start the
+ *         recovery of Dandelion+ and Dandelion++ are visited. Each part is
+ *         shared among the workers
+ */
+void lunes_user_churn_handler(context_t *ctx) {
+	churn_action action;
+	hash_node_t *node;
+	guint        i, d, n, kept;
+	int          next;
+
+	if ((int)ctx->simclock == env_max_ttl) {						//just once: the churn starts, scheduling all the local nodes
+		for (i = 0; i < (guint)ctx->stable->count; i++) {
+			node = &ctx->stable->node[i];
+			if ((next = lunes_churn_next(ctx, node)) != -1) {
+				calendar_insert(&ctx->model->churn_calendar, next, node->data->key);
+			}
+			lunes_watch_isolated(ctx, node);
+		}
+		return;
+	}
+	if ((int)ctx->simclock <= env_max_ttl) {
+		return;
+	}
+
+	// Isolated nodes and candidates for the recovery found in this timestep
+	lunes_merge_watch(ctx, ctx->model->isolated_watch, 0);
+	lunes_merge_watch(ctx, ctx->model->stem_watch, 1);
+
+	// At each step there is the chance for a node to activate or deactivate: the
+	// nodes with a scheduled change and the isolated ones, merged by ID
+	calendar_pop(&ctx->model->churn_calendar, (int)ctx->simclock, ctx->model->churn_due);
+	g_array_set_size(ctx->model->churn_actions, 0);
+	for (d = 0, n = 0; d < ctx->model->churn_due->len || n < ctx->model->isolated_watch->len; ) {
+		action.due      = (d < ctx->model->churn_due->len) && (n >= ctx->model->isolated_watch->len || g_array_index(ctx->model->churn_due, int, d) <= g_array_index(ctx->model->isolated_watch, int, n));
+		action.key      = action.due ? g_array_index(ctx->model->churn_due, int, d) : g_array_index(ctx->model->isolated_watch, int, n);
+		action.isolated = (n < ctx->model->isolated_watch->len) && (g_array_index(ctx->model->isolated_watch, int, n) == action.key);
+		action.action   = CHURN_NONE;
+		action.next     = -1;
+		d += action.due;
+		n += action.isolated;
+		g_array_append_val(ctx->model->churn_actions, action);
+	}
+	g_array_set_size(ctx->model->isolated_watch, 0);
 
-	// dandelion++ recovery mechanism: nodes that received the message in the stem phase start the fluff phase if they don't receive the message back in
-	if ((env_dissemination_mode == DANDELIONPLUS  && node->data->received > 0 && simclock > 400 && node->data->status !=0 &&                      //DANDELIONPLUS
-	   simclock - node->data->received > env_dandelion_stem_steps + 4 && node->data->received % env_max_ttl <= env_dandelion_stem_steps) ||
-		(env_dissemination_mode == DANDELIONPLUSPLUS  && node->data->received > 0 && simclock > 400 && node->data->status !=0 &&                      //DANDELION++
-	   simclock - node->data->received > 7 && node->data->received % env_max_ttl <= env_dandelion_stem_steps && is_in_stem_mode(node)==1 )){         
-		RequestMsg     msg;
-        msg.request_static.type = 'R';
-        msg.request_static.timestamp = simclock;
-        msg.request_static.ttl       = env_max_ttl - ((int)simclock % env_max_ttl);
-        msg.request_static.creator   = node->data->key;
-        Msg m = (Msg) msg;
-		lunes_forward_to_neighbors(node, &m, --(msg.request_static.ttl), simclock, 0, msg.request_static.creator, node->data->key);                            
-		
-		node->data->received = -1;
+	pool_run(lunes_churn_transition_task, ctx->model->churn_actions->len, ctx);
+	for (i = 0; i < ctx->model->churn_actions->len; i++) {
+		if ((next = g_array_index(ctx->model->churn_actions, churn_action, i).next) != -1) {
+			calendar_insert(&ctx->model->churn_calendar, next, g_array_index(ctx->model->churn_actions, churn_action, i).key);
+		}
 	}
+	pool_run(lunes_churn_link_task, ctx->model->churn_actions->len, ctx);
 
+	// Recovery
+	pool_run(lunes_recovery_task, ctx->model->stem_watch->len, ctx);
+	for (i = 0, kept = 0; i < ctx->model->stem_watch->len; i++) {
+		if (g_array_index(ctx->model->stem_watch, int, i) != -1) {
+			g_array_index(ctx->model->stem_watch, int, kept++) = g_array_index(ctx->model->stem_watch, int, i);
+		}
+	}
+	g_array_set_size(ctx->model->stem_watch, kept);
+}
+
+/*! \brief A node migrated in this LP: its calendar entry has been dropped by the
+ *         source LP (see lunes_churn_transition_task()), its next change of
+ *         activity is scheduled here. A stale entry, left when the node moved
+ *         away from this LP, is removed first. Before the churn starts the node
+ *         is scheduled with all the others (see lunes_user_churn_handler())
+ */
+void lunes_user_migration_event_handler(context_t *ctx, hash_node_t *node) {
+	int next;
+
+	calendar_remove(&ctx->model->churn_calendar, node->data->key);
+	if ((int)ctx->simclock > env_max_ttl && (next = lunes_churn_next(ctx, node)) != -1) {
+		calendar_insert(&ctx->model->churn_calendar, next, node->data->key);
+	}
 }
 
 // request
-void lunes_user_request_event_handler(hash_node_t *node, int forwarder, Msg *msg) {
-	countMessages++;
-	if (node->data->status == 3){  //if it's the holder node
-		node->data->status = 4;
-		countSteps += (int)simclock % env_max_ttl;
-		countDelivers++;
+void lunes_user_request_event_handler(context_t *ctx, hash_node_t *node, int forwarder, Msg *msg) {
+	lunes_worker_t *worker = &ctx->model->worker_data[pool_worker()];
+	int             id     = msg->request.request_static.id;
+	int             k      = id % env_lookups;                                 // The lookup of the message
+	int             hops;
+
+	worker->messages++;
+	worker->epoch.messages++;
+	ctx->model->load[node->data->key]++;                                        // The receivers are not shared among the workers
+	if (ctx->holder[k] == node->data->key && ctx->model->lookup_holder[k] == LOOKUP_HOLDER){  //if it's the holder node
+		ctx->model->lookup_holder[k] = LOOKUP_DELIVERED;
+		hops = (int)ctx->simclock - (id / env_lookups) * env_max_ttl;           // Timesteps since the beginning of the lookup
+		worker->steps += (int)ctx->simclock % env_max_ttl;
+		worker->delivers++;
+		worker->lookup_delivers[k]++;
+		worker->epoch.delivers++;
+		worker->epoch.hops += hops;
+		histogram_record(&worker->hops, hops);
 	}
-	else if (node->data->status == 1 
-	|| (node->data->status != 0 && env_dissemination_mode == DANDELION && (int) simclock % env_max_ttl <= env_dandelion_stem_steps) //allows nodes int the stem phase to forward messages
-	|| (node->data->status != 0 && env_dissemination_mode == DANDELIONPLUSPLUS && is_in_stem_mode(node)==1 ) 
-	|| (node->data->status != 0 && env_dissemination_mode == DANDELIONPLUS && (int) simclock % env_max_ttl <= env_dandelion_stem_steps)){ 
-		node->data->status = 5;
-		lunes_forward_to_neighbors(node, msg,  --(msg->request.request_static.ttl),  msg->request.request_static.timestamp, (int)simclock, msg->request.request_static.creator, forwarder);
+	else if ((SE_STATUS(ctx, node) != 0 && lunes_lookup_idle(ctx, node, id))
+	|| (SE_STATUS(ctx, node) != 0 && env_dissemination_mode == DANDELION && (int) ctx->simclock % env_max_ttl <= env_dandelion_stem_steps) //allows nodes int the stem phase to forward messages
+	|| (SE_STATUS(ctx, node) != 0 && env_dissemination_mode == DANDELIONPLUSPLUS && is_in_stem_mode(ctx, node)==1 ) 
+	|| (SE_STATUS(ctx, node) != 0 && env_dissemination_mode == DANDELIONPLUS && (int) ctx->simclock % env_max_ttl <= env_dandelion_stem_steps)){ 
+		// The applicant and the holder lose their role once they forward the message
+		lunes_set_seen(ctx, node, id);
+		if (ctx->applicant[k] == node->data->key) {
+			ctx->model->lookup_applicant[k] = LOOKUP_FORWARDED;
+		}
+		if (ctx->holder[k] == node->data->key) {
+			ctx->model->lookup_holder[k] = LOOKUP_FORWARDED;
+		}
+		lunes_forward_to_neighbors(ctx, node, msg,  --(msg->request.request_static.ttl),  msg->request.request_static.timestamp, id, msg->request.request_static.creator, forwarder);
 	}
 
 	if (env_dissemination_mode==DANDELIONPLUS){
-		if (node->data->received >= 0 && (int)simclock % env_max_ttl <= env_dandelion_stem_steps){
-			node->data->received = (int) simclock;
+		if (lunes_get_received(ctx, node, id) >= 0 && (int)ctx->simclock % env_max_ttl <= env_dandelion_stem_steps){
+			lunes_set_received(ctx, node, id, (int) ctx->simclock);
 		} else  {
-			node->data->received = -1;
+			lunes_set_received(ctx, node, id, -1);
 		}
 	}
 
-	if (env_dissemination_mode==DANDELIONPLUSPLUS && is_in_stem_mode(node)==1){
-		if (node->data->received >= 0){
-			node->data->received = (int) simclock;
+	if (env_dissemination_mode==DANDELIONPLUSPLUS && is_in_stem_mode(ctx, node)==1){
+		if (lunes_get_received(ctx, node, id) >= 0){
+			lunes_set_received(ctx, node, id, (int) ctx->simclock);
 		} else  {
-			node->data->received = -1;
+			lunes_set_received(ctx, node, id, -1);
 		}
 	}
 }
\ No newline at end of file
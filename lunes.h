@@ -16,19 +16,44 @@
 
 #include "utils.h"
 #include "entity_definition.h"
+#include "checkpoint.h"
+#include "context.h"
 
 
-void lunes_real_forward(hash_node_t *, Msg *, unsigned short, float, int, unsigned int, unsigned int);
-void lunes_forward_to_neighbors(hash_node_t *, Msg *, unsigned short, float, int, unsigned int, unsigned int);
+void lunes_real_forward(context_t *, hash_node_t *, Msg *, unsigned short, float, int, unsigned int, unsigned int);
+void lunes_forward_to_neighbors(context_t *, hash_node_t *, Msg *, unsigned short, float, int, unsigned int, unsigned int);
 
 
 // LUNES handlers
-void lunes_user_request_event_handler(hash_node_t *, int, Msg *);
-void lunes_user_register_event_handler(hash_node_t *);
-void lunes_user_control_handler(hash_node_t *);
+void lunes_user_request_event_handler(context_t *, hash_node_t *, int, Msg *);
+void lunes_user_register_event_handler(context_t *, hash_node_t *);
+void lunes_user_control_handler(context_t *, hash_node_t *);
+void lunes_user_epoch_handler(context_t *);
+void lunes_user_churn_handler(context_t *);
+void lunes_user_migration_event_handler(context_t *, hash_node_t *);
+void lunes_user_bootstrap_handler(context_t *);
+void lunes_user_statistics_handler(context_t *, FILE *);
+void lunes_user_shutdown_handler(context_t *);
+void lunes_user_sweep_handler(context_t *, int);
+void lunes_user_checkpoint_save_handler(context_t *, checkpoint_t *);
+void lunes_user_checkpoint_restore_handler(context_t *, checkpoint_t *);
+
+// Churn
+int  lunes_churn_delay(context_t *, hash_node_t *, double);
+int  lunes_churn_next(context_t *, hash_node_t *);
+void lunes_watch_isolated(context_t *, hash_node_t *);
+
+// Progress of the nodes in the lookups
+int  lunes_get_received(context_t *, hash_node_t *, int);
+void lunes_set_received(context_t *, hash_node_t *, int, int);
+int  lunes_lookup_id(context_t *, int);
+int  lunes_lookup_role(context_t *, hash_node_t *);
+int  lunes_seen(context_t *, hash_node_t *, int);
+void lunes_set_seen(context_t *, hash_node_t *, int);
+void lunes_clear_seen(context_t *, hash_node_t *);
+int  lunes_initial_status(context_t *, int);
 
 // Support functions
-void lunes_dot_tokenizer(char *, int *, int *);
-void lunes_load_graph_topology();  
+void lunes_load_graph_topology(context_t *);
 
 #endif /* __LUNES_H */
@@ -18,6 +18,18 @@
 #define MAX_TTL                    10                       // TTL of new messages, standard value
 #define MEAN_NEW_MESSAGE           2000                     // Generation of new transactions and checks: exponential distribution, mean value
 #define PERC_GENERATORS            100.00                   // Percentage of nodes that generate new messages
+#define CHURN_CALENDAR_SIZE        1024                     // Buckets (timesteps) of the churn calendar queue
+#define MAX_LOOKUPS                64                       // Max concurrent lookups in each epoch (see LOOKUPS)
+#define CACHE_SIZE                 8                        // Messages remembered by each node, default (see CACHE_SIZE)
+#define WARMUP_STEPS               400                      // Timesteps for the network to stabilize, the lookups start after them
+#define MAX_SWEEP                  64                       // Max configurations of a sweep (see SWEEP)
+
+//	Progress of the applicant and of the holder in a lookup
+#define LOOKUP_IDLE                0    // No lookup started yet
+#define LOOKUP_APPLICANT           2    // Sender of the message
+#define LOOKUP_HOLDER              3    // Destination of the message
+#define LOOKUP_DELIVERED           4    // Destination, the message has been received
+#define LOOKUP_FORWARDED           5    // Received and forwarded the message
 
 //	Dissemination protocols
 #define BROADCAST                  0    // Probabilistic broadcast
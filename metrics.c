@@ -0,0 +1,114 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Metrics stream: a fixed-size record for each epoch (see
+ *                      metrics.h), appended by the model level (see lunes.c)
+ *                      after a header that identifies the run. The records
+ *                      are kept in memory and written a block at a time, the
+ *                      file can be read while the run goes on (e.g. to follow
+ *                      the convergence) and it is complete at the end of the run
+ *              -	A run resumed from a checkpoint goes on with the file of the
+ *                      interrupted run, after the records written before the
+ *                      checkpoint (see metrics_resume())
+ *              -	Any I/O error is fatal
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "metrics.h"
+
+
+/*! \brief Fatal I/O error on a metrics file
+ */
+static void metrics_fail(metrics_t *metrics, const char *what) {
+    fprintf(stdout, "FATAL ERROR, metrics %s: %s\n", metrics->name, what);
+    fflush(stdout);
+    exit(-1);
+}
+
+/*! \brief Starts writing a metrics file (an existing one is replaced)
+ */
+void metrics_create(metrics_t *metrics, const char *name, const metrics_header *header) {
+    snprintf(metrics->name, sizeof(metrics->name), "%s", name);
+    metrics->count = 0;
+
+    if ((metrics->file = fopen(name, "wb")) == NULL) {
+        metrics_fail(metrics, "impossible to create the file");
+    }
+    if (fwrite(header, sizeof(metrics_header), 1, metrics->file) != 1 || fflush(metrics->file) != 0) {
+        metrics_fail(metrics, "write error");
+    }
+}
+
+/*! \brief Goes on writing the metrics file of an interrupted run: the records
+ *         of the epochs before "epoch" are kept, the following ones (written
+ *         after the checkpoint the run resumes from) are dropped
+ */
+void metrics_resume(metrics_t *metrics, const char *name, const metrics_header *header, int32_t epoch) {
+    metrics_header found;
+    metrics_record record;
+    long           kept = 0;
+
+    snprintf(metrics->name, sizeof(metrics->name), "%s", name);
+    metrics->count = 0;
+
+    if ((metrics->file = fopen(name, "r+b")) == NULL) {
+        metrics_fail(metrics, "impossible to open the file of the interrupted run");
+    }
+    if (fread(&found, sizeof(metrics_header), 1, metrics->file) != 1 || memcmp(&found, header, sizeof(metrics_header)) != 0) {
+        metrics_fail(metrics, "the file does not belong to this run");
+    }
+    while (fread(&record, sizeof(metrics_record), 1, metrics->file) == 1 && record.epoch < epoch) {
+        kept++;
+    }
+    if (fseek(metrics->file, (long)sizeof(metrics_header) + kept * (long)sizeof(metrics_record), SEEK_SET) != 0 ||
+        ftruncate(fileno(metrics->file), (off_t)sizeof(metrics_header) + kept * (off_t)sizeof(metrics_record)) != 0) {
+        metrics_fail(metrics, "write error");
+    }
+}
+
+/*! \brief Appends the record of an epoch, the buffer is written when full
+ */
+void metrics_append(metrics_t *metrics, const metrics_record *record) {
+    metrics->buffer[metrics->count++] = *record;
+    if (metrics->count == METRICS_BUFFER) {
+        metrics_flush(metrics);
+    }
+}
+
+/*! \brief Writes the buffered records
+ */
+void metrics_flush(metrics_t *metrics) {
+    if (metrics->count > 0 &&
+        (fwrite(metrics->buffer, sizeof(metrics_record), metrics->count, metrics->file) != (size_t)metrics->count ||
+         fflush(metrics->file) != 0)) {
+        metrics_fail(metrics, "write error");
+    }
+    metrics->count = 0;
+}
+
+/*! \brief Completes the metrics file
+ */
+void metrics_close(metrics_t *metrics) {
+    metrics_flush(metrics);
+    if (fclose(metrics->file) != 0) {
+        metrics_fail(metrics, "write error");
+    }
+    metrics->file = NULL;
+}
+
+/*! \brief Drops the buffered records and closes the file without writing
+ *         them: used by a forked process, the records belong to its parent
+ */
+void metrics_discard(metrics_t *metrics) {
+    metrics->count = 0;
+    fclose(metrics->file);
+    metrics->file = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,73 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "metrics.c" description
+ *              -	Metrics file format
+ *              -	Function prototypes
+ *
+ ############################################################################################### */
+
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+
+#define METRICS_MAGIC         "LUNESMET"
+#define METRICS_VERSION       1
+#define METRICS_BUFFER        512           // Records kept in memory before a write
+
+/*! \brief Header of a metrics file: the run it belongs to and the size of
+ *         the records that follow it
+ */
+typedef struct metrics_header {
+    char    magic[8];                       // METRICS_MAGIC
+    int32_t version;                        // METRICS_VERSION
+    int32_t record_size;                    // sizeof(metrics_record)
+    int32_t lp;                             // LP that wrote it
+    int32_t lps;                            // Number of LPs
+    int32_t entities;                       // SEs of each LP
+    int32_t max_ttl;                        // Length of the epochs
+    int32_t lookups;                        // Concurrent lookups in each epoch
+    int32_t replica;                        // Replica of the run (see REPLICAS), or configuration of the sweep
+} metrics_header;
+
+/*! \brief Record of an epoch, as seen by the local nodes of an LP: the records of
+ *         the LPs of a run are summed field by field (but epoch)
+ */
+typedef struct metrics_record {
+    int32_t epoch;                          // Epoch (its first timestep is epoch * MAX_TTL)
+    int32_t lookups;                        // Lookups started by the local applicants
+    int32_t delivers;                       // Lookups that reached their holder (a local node)
+    int32_t hops;                           // Sum of the latency of the deliveries, in timesteps
+    int32_t covered;                        // Local nodes that forwarded a message of the epoch (for each lookup)
+    int32_t active;                         // Active local nodes at the beginning of the epoch
+    int32_t links;                          // Links of the local nodes at the beginning of the epoch
+    int32_t reserved;
+    int64_t messages;                       // Requests received by the local nodes
+} metrics_record;
+
+/*! \brief A metrics file being written, the records are buffered
+ */
+typedef struct metrics_t {
+    FILE *         file;
+    char           name[1024];
+    int            count;                   // Records in the buffer
+    metrics_record buffer[METRICS_BUFFER];
+} metrics_t;
+
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+void metrics_create(metrics_t *, const char *, const metrics_header *);
+void metrics_resume(metrics_t *, const char *, const metrics_header *, int32_t);
+void metrics_append(metrics_t *, const metrics_record *);
+void metrics_flush(metrics_t *);
+void metrics_close(metrics_t *);
+void metrics_discard(metrics_t *);
+
+#endif /* __METRICS_H */
@@ -0,0 +1,176 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Mock of the ARTÌS runtime, enough to run t_graph as a single
+ *                      LP without SIMA (see check-threads): the SEs registered by
+ *                      the LP are notified back, the messages are delivered at
+ *                      their timestep and then the EOS is returned
+ *              -	The random numbers are a xorshift stream, the configuration
+ *                      files are never read
+ *              -	At the end of the run the number of GAIA messages is printed
+ *                      on stderr ("mock: GAIA messages ...")
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gaia.h"
+#include "rnd.h"
+#include "ini.h"
+
+
+// Messages in flight, a list for each of the next MOCK_STEPS timesteps
+#define MOCK_STEPS              64
+
+typedef struct mock_message {
+    int                  from, to;
+    double               ts;
+    unsigned int         size;
+    struct mock_message *next;
+    char                 data[];
+} mock_message;
+
+static mock_message *mock_head[MOCK_STEPS], *mock_tail[MOCK_STEPS];
+static double        mock_clock;
+static int           mock_first, mock_registered, mock_notified;
+static long          mock_messages, mock_bytes;
+
+
+int GAIA_Initialize(int entities, int lps, char *seeds, char *name, char *host, int port) {
+    return(0);
+}
+
+double GAIA_GetStep(void) {
+    return(1.0);
+}
+
+void GAIA_SetFstID(int id) {
+    mock_first = id;
+}
+
+int GAIA_Register(char migrable) {
+    return(mock_first + mock_registered++);
+}
+
+void GAIA_Send(int from, int to, double ts, void *data, unsigned int size) {
+    mock_message *message;
+    int           s = (int)ts % MOCK_STEPS;
+
+    if (ts <= mock_clock || ts >= mock_clock + MOCK_STEPS) {
+        fprintf(stderr, "mock: FATAL ERROR, message sent at %f for the timestep %f\n", mock_clock, ts);
+        exit(-1);
+    }
+    if ((message = malloc(sizeof(mock_message) + size)) == NULL) {
+        fprintf(stderr, "mock: FATAL ERROR, malloc error\n");
+        exit(-1);
+    }
+    message->from = from;
+    message->to   = to;
+    message->ts   = ts;
+    message->size = size;
+    message->next = NULL;
+    memcpy(message->data, data, size);
+
+    if (mock_tail[s]) {
+        mock_tail[s]->next = message;
+    } else {
+        mock_head[s] = message;
+    }
+    mock_tail[s] = message;
+    mock_messages++;
+    mock_bytes += size;
+}
+
+char GAIA_Receive(int *from, int *to, double *ts, void *data, int *size) {
+    mock_message *message;
+    int           s = (int)mock_clock % MOCK_STEPS;
+
+    // The registrations of the local SEs come first
+    if (mock_notified < mock_registered) {
+        *from = mock_first + mock_notified++;
+        *to   = 0;
+        *ts   = mock_clock;
+        return(REGISTER);
+    }
+    if ((message = mock_head[s]) == NULL) {
+        return(EOS);
+    }
+    if ((mock_head[s] = message->next) == NULL) {
+        mock_tail[s] = NULL;
+    }
+    *from = message->from;
+    *to   = message->to;
+    *ts   = message->ts;
+    *size = message->size;
+    memcpy(data, message->data, message->size);
+    free(message);
+    return(UNSET);
+}
+
+double GAIA_TimeAdvance(void) {
+    mock_clock += 1.0;
+    return(mock_clock);
+}
+
+void GAIA_GetStatistics(int *local, int *remote, int *migrations) {
+    *local      = 1;
+    *remote     = 0;
+    *migrations = 0;
+}
+
+void GAIA_Finalize(void) {
+    fprintf(stderr, "mock: GAIA messages %ld, bytes %ld\n", mock_messages, mock_bytes);
+}
+
+void GAIA_SetMigration(int migration) {
+}
+
+void GAIA_SetMF(float factor) {
+}
+
+void GAIA_SetLoadBalancing(int load) {
+}
+
+int GAIA_Migrate(int id, void *data, unsigned int size) {
+    return(0);
+}
+
+void RND_Init(TSeed *seed, char *file, int lp) {
+    seed->s = 88172645463325252ULL + lp;
+}
+
+static unsigned long long rnd_next(TSeed *seed) {
+    seed->s ^= seed->s << 13;
+    seed->s ^= seed->s >> 7;
+    seed->s ^= seed->s << 17;
+    return(seed->s);
+}
+
+double RND_Interval(TSeed *seed, double a, double b) {
+    return(a + (b - a) * ((rnd_next(seed) >> 11) * (1.0 / 9007199254740992.0)));
+}
+
+int RND_Integer(TSeed *seed, double a, double b) {
+    return((int)(a + (rnd_next(seed) % (unsigned long long)(b - a + 1))));
+}
+
+double RND_Exponential(TSeed *seed, double mean) {
+    return(mean);
+}
+
+int INI_Load(char *file) {
+    return(INI_OK);
+}
+
+int INI_Read(char *section, char *key, char *value) {
+    value[0] = '\0';
+    return(INI_OK);
+}
+
+void INI_Free(void) {
+}
+
+/*---------------------------------------------------------------------------*/
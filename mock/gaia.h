@@ -0,0 +1,41 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Mock of the GAIA API used by t_graph (see artis.c), it
+ *                      takes the place of the ARTÌS headers in the checks
+ *
+ ############################################################################################### */
+
+#ifndef __MOCK_GAIA_H
+#define __MOCK_GAIA_H
+
+// Types of the messages returned by GAIA_Receive()
+#define NOTIF_MIGR              'N'
+#define NOTIF_MIGR_EXT          'E'
+#define REGISTER                'G'
+#define EXEC_MIGR               'X'
+#define EOS                     'S'
+#define UNSET                   'Z'
+
+#define MIGR_OFF                0
+#define LOAD_ON                 1
+#define LOAD_OFF                0
+
+
+int    GAIA_Initialize(int, int, char *, char *, char *, int);
+double GAIA_GetStep(void);
+void   GAIA_SetFstID(int);
+int    GAIA_Register(char);
+char   GAIA_Receive(int *, int *, double *, void *, int *);
+void   GAIA_Send(int, int, double, void *, unsigned int);
+double GAIA_TimeAdvance(void);
+void   GAIA_GetStatistics(int *, int *, int *);
+void   GAIA_Finalize(void);
+void   GAIA_SetMigration(int);
+void   GAIA_SetMF(float);
+void   GAIA_SetLoadBalancing(int);
+int    GAIA_Migrate(int, void *, unsigned int);
+
+#endif /* __MOCK_GAIA_H */
@@ -0,0 +1,20 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Mock of the ARTÌS configuration files API (see artis.c)
+ *
+ ############################################################################################### */
+
+#ifndef __MOCK_INI_H
+#define __MOCK_INI_H
+
+#define INI_OK                  0
+
+
+int  INI_Load(char *);
+int  INI_Read(char *, char *, char *);
+void INI_Free(void);
+
+#endif /* __MOCK_INI_H */
@@ -0,0 +1,23 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Mock of the ARTÌS random numbers API (see artis.c)
+ *
+ ############################################################################################### */
+
+#ifndef __MOCK_RND_H
+#define __MOCK_RND_H
+
+typedef struct TSeed {
+    unsigned long long s;
+} TSeed;
+
+
+void   RND_Init(TSeed *, char *, int);
+double RND_Interval(TSeed *, double, double);
+int    RND_Integer(TSeed *, double, double);
+double RND_Exponential(TSeed *, double);
+
+#endif /* __MOCK_RND_H */
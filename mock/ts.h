@@ -0,0 +1,13 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Mock of the ARTÌS time-stepped API, nothing is used by t_graph
+ *
+ ############################################################################################### */
+
+#ifndef __MOCK_TS_H
+#define __MOCK_TS_H
+
+#endif /* __MOCK_TS_H */
@@ -22,6 +22,7 @@ typedef struct _request_msg    RequestMsg; // Interactions among messages
 typedef struct _link_msg       LinkMsg;  // Network constructions
 typedef struct _unlink_msg     UnlinkMsg;  // Network constructions
 typedef struct _migr_msg       MigrMsg;  // Migration message
+typedef struct _frame_msg      FrameMsg; // Model messages to the same LP, packed
 typedef union   msg            Msg;
 
 // General note:
@@ -29,18 +30,31 @@ typedef union   msg            Msg;
 //	-	the static part contains a pre-defined set of variables, and the size
 //		of the dynamic part (as number of records)
 //	-	a dynamic part that is composed of a sequence of records
+//
+//	The model messages (request, link and unlink) are packed (no padding on
+//	the wire) and carry the version of their encoding. Only their own struct
+//	is built by the sender, the Msg union is used just to read a received
+//	model message. The migration messages (large) are not in the union
+
+// Version of the encoding of the model messages
+#define MSG_VERSION    1
+
+// Alignment of the model messages in the frames and in the local queue
+#define MSG_ALIGN      4
+#define MSG_PADDED(size)    (((size) + MSG_ALIGN - 1) & ~(MSG_ALIGN - 1))
 
 
 struct _request_static_part {
     char           type;                    // Message type
-    float          timestamp;               // Timestep of creation (of the message)
+    unsigned char  version;                 // Encoding version (MSG_VERSION)
     unsigned short ttl;                     // Time-To-Live
+    float          timestamp;               // Timestep of creation (of the message)
     int            id;                 	    // Message Identifier
     unsigned int   creator;                 // ID of the original sender of the message
    // #ifdef DEGREE_DEPENDENT_GOSSIP_SUPPORT
     unsigned int   num_neighbors;           // Number of neighbors of forwarder
     //#endif
-};
+} __attribute__((packed));
 //
 
 struct _request_msg {
@@ -58,8 +72,9 @@ struct _link_record {
 //
 /*! \brief Static part of link messages */
 struct _link_static_part {
-    char type; // Message type
-};
+    char          type;    // Message type
+    unsigned char version; // Encoding version (MSG_VERSION)
+} __attribute__((packed));
 //
 /*! \brief Link message */
 struct _link_msg {
@@ -74,8 +89,9 @@ struct _unlink_record {
 //
 /*! \brief Static part of unlink messages */
 struct _unlink_static_part {
-    char type; // Message type
-};
+    char          type;    // Message type
+    unsigned char version; // Encoding version (MSG_VERSION)
+} __attribute__((packed));
 //
 /*! \brief unLink message */
 struct _unlink_msg {
@@ -106,14 +122,60 @@ struct _migr_msg {
 
 
 
-/*! \brief Union structure for all types of messages */
+// **********************************************
+// FRAME MESSAGES
+// **********************************************
+//
+/*! \brief Record of a frame: a model message, its payload follows (padded to MSG_ALIGN) */
+struct _frame_record {
+    int          from;          // Sender of the model message
+    int          to;            // Receiver of the model message
+    unsigned int size;          // Size of the payload
+};
+//
+/*! \brief Static part of frame messages, the records follow (from offset FRAME_HEADER) */
+struct _frame_static_part {
+    char          type;         // Message type
+    unsigned int  records;      // Number of records in the frame
+};
+//
+/*! \brief Frame message, the whole frame is at most FRAME_SIZE bytes */
+struct _frame_msg {
+    struct  _frame_static_part frame_static; // Static part
+};
+
+#define FRAME_HEADER    MSG_PADDED(sizeof(struct _frame_static_part))
+#define FRAME_RECORD    MSG_PADDED(sizeof(struct _frame_record))
+
+
+// **********************************************
+// SIZE TABLE
+// **********************************************
+//
+// Bytes sent for each type of model message
+#define REQUEST_MSG_SIZE    sizeof(struct _request_static_part)
+#define LINK_MSG_SIZE       sizeof(struct _link_static_part)
+#define UNLINK_MSG_SIZE     sizeof(struct _unlink_static_part)
+
+// A change of these sizes is a change of the encoding (see MSG_VERSION)
+_Static_assert(REQUEST_MSG_SIZE == 20, "unexpected size of the request messages");
+_Static_assert(LINK_MSG_SIZE == 2, "unexpected size of the link messages");
+_Static_assert(UNLINK_MSG_SIZE == 2, "unexpected size of the unlink messages");
+_Static_assert(FRAME_RECORD == 12, "unexpected size of the frame records");
+
+
+/*! \brief Union structure for all types of model messages (and frames) */
 union msg {
     char       type;
     LinkMsg    link;
     RequestMsg request;
-    MigrMsg    migr;
     UnlinkMsg  unlink;
+    FrameMsg   frame;
 };
+
+_Static_assert(sizeof(Msg) <= 2 * REQUEST_MSG_SIZE, "the Msg union has to stay small");
+_Static_assert(_Alignof(Msg) <= MSG_ALIGN, "the Msg union is aligned to more than MSG_ALIGN");
+
 /*---------------------------------------------------------------------------*/
 
 #endif /* __MESSAGE_DEFINITION_H */
@@ -0,0 +1,265 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Pool of worker threads used inside the LP: a parallel
+ *                      section hands out chunks of items (e.g. SEs) to the
+ *                      workers and returns when all of them are done (barrier).
+ *                      The calling thread is worker 0.
+ *              -	Messages sent during a parallel section are appended to
+ *                      an outbound buffer of the worker and passed to the
+ *                      send path (see frame.c), worker by worker, at the end
+ *                      of the section
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include "utils.h"
+#include "context.h"
+#include "frame.h"
+#include "pool.h"
+
+
+/* ************************************************************************ */
+/*       L O C A L	V A R I A B L E S			                            */
+/* ************************************************************************ */
+
+// Header of a message in an outbound buffer, the payload follows
+typedef struct pool_record {
+    context_t *  ctx;
+    int          from;
+    int          to;
+    double       ts;
+    unsigned int size;
+} pool_record;
+
+static int             pool_size = 1;                           // Number of workers (calling thread included)
+static pthread_t *     pool_threads;
+static GByteArray **   pool_outbound;                           // Outbound buffer of each worker
+static __thread int    pool_worker_id;                          // Worker executing the calling thread
+static int             pool_parallel;                           // True inside a parallel section
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_start = PTHREAD_COND_INITIALIZER;   // A new section is available
+static pthread_cond_t  pool_done  = PTHREAD_COND_INITIALIZER;   // All the workers finished the section
+static unsigned int    pool_generation;                         // Sections started so far
+static int             pool_busy;                               // Workers still running the section
+static int             pool_quit;
+
+// The current section
+static void (*pool_task)(int, int, void *);
+static void *          pool_arg;
+static int             pool_items;
+static volatile gint   pool_next;                               // First item not yet handed out
+
+
+/*! \brief Runs chunks of the current section until all the items are handed out
+ */
+static void pool_section() {
+    int first;
+
+    while ((first = g_atomic_int_add(&pool_next, POOL_CHUNK)) < pool_items) {
+        pool_task(first, MIN(first + POOL_CHUNK, pool_items), pool_arg);
+    }
+}
+
+/*! \brief Main loop of the workers (1, 2, ...)
+ */
+static void *pool_main(void *arg) {
+    unsigned int generation = 0;
+
+    pool_worker_id = (int)(intptr_t)arg;
+
+    pthread_mutex_lock(&pool_mutex);
+    for (;;) {
+        while (pool_generation == generation && !pool_quit) {
+            pthread_cond_wait(&pool_start, &pool_mutex);
+        }
+        if (pool_quit) {
+            break;
+        }
+        generation = pool_generation;
+        pthread_mutex_unlock(&pool_mutex);
+
+        pool_section();
+
+        pthread_mutex_lock(&pool_mutex);
+        if (--pool_busy == 0) {
+            pthread_cond_signal(&pool_done);
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    return(NULL);
+}
+
+/*! \brief Passes to the send path the messages buffered during the section, the
+ *         buffers are emptied in the order of the workers
+ */
+static void pool_flush() {
+    pool_record *record;
+    guint        position;
+    int          w;
+
+    for (w = 0; w < pool_size; w++) {
+        position = 0;
+        while (position < pool_outbound[w]->len) {
+            record = (pool_record *)(pool_outbound[w]->data + position);
+            frame_send(record->ctx, record->from, record->to, record->ts, (void *)(record + 1), record->size);
+            position += sizeof(pool_record) + ((record->size + 7) & ~7u);
+        }
+        g_byte_array_set_size(pool_outbound[w], 0);
+    }
+}
+
+/*! \brief Starts the workers, the calling thread is the worker 0
+ */
+void pool_init(int workers) {
+    int w;
+
+    pool_size     = (workers < 1) ? 1 : workers;
+    pool_threads  = (pthread_t *)malloc(sizeof(pthread_t) * pool_size);
+    pool_outbound = (GByteArray **)malloc(sizeof(GByteArray *) * pool_size);
+    ASSERT((pool_threads != NULL && pool_outbound != NULL), ("pool_init: malloc error"));
+
+    for (w = 0; w < pool_size; w++) {
+        pool_outbound[w] = g_byte_array_new();
+    }
+    pool_worker_id = 0;
+    for (w = 1; w < pool_size; w++) {
+        if (pthread_create(&pool_threads[w], NULL, pool_main, (void *)(intptr_t)w) != 0) {
+            fprintf(stdout, "FATAL ERROR, impossible to start the worker thread %d\n", w);
+            fflush(stdout);
+            exit(-1);
+        }
+    }
+}
+
+/*! \brief Starts the workers again in a child process: after fork() only the
+ *         calling thread is left, the state of the pool is reset
+ *         NOTE: to be called outside the parallel sections
+ */
+void pool_restart() {
+    int w;
+
+    pthread_mutex_init(&pool_mutex, NULL);
+    pthread_cond_init(&pool_start, NULL);
+    pthread_cond_init(&pool_done, NULL);
+    pool_generation = 0;
+    pool_busy       = 0;
+    pool_quit       = 0;
+    pool_parallel   = 0;
+    pool_worker_id  = 0;
+
+    for (w = 1; w < pool_size; w++) {
+        if (pthread_create(&pool_threads[w], NULL, pool_main, (void *)(intptr_t)w) != 0) {
+            fprintf(stdout, "FATAL ERROR, impossible to start the worker thread %d\n", w);
+            fflush(stdout);
+            exit(-1);
+        }
+    }
+}
+
+/*! \brief Stops and joins the workers
+ */
+void pool_shutdown() {
+    int w;
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_quit = 1;
+    pthread_cond_broadcast(&pool_start);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (w = 1; w < pool_size; w++) {
+        pthread_join(pool_threads[w], NULL);
+    }
+    for (w = 0; w < pool_size; w++) {
+        g_byte_array_free(pool_outbound[w], TRUE);
+    }
+    free(pool_outbound);
+    free(pool_threads);
+}
+
+/*! \brief Number of workers
+ */
+int pool_workers() {
+    return(pool_size);
+}
+
+/*! \brief Worker executing the calling thread (0 outside the parallel sections)
+ */
+int pool_worker() {
+    return(pool_worker_id);
+}
+
+/*! \brief Parallel section: task(first, last, arg) is executed on chunks of
+ *         [0, items) by all the workers, it returns when all the items are done
+ *         and the buffered messages have been sent.
+ *         NOTE: the task must touch only the data of its own items
+ */
+void pool_run(void (*task)(int, int, void *), int items, void *arg) {
+    // Nothing to share: running in the calling thread, the messages are sent immediately
+    if (pool_size == 1 || items <= POOL_CHUNK) {
+        if (items > 0) {
+            task(0, items, arg);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_task     = task;
+    pool_arg      = arg;
+    pool_items    = items;
+    pool_next     = 0;
+    pool_busy     = pool_size - 1;
+    pool_parallel = 1;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_start);
+    pthread_mutex_unlock(&pool_mutex);
+
+    pool_section();
+
+    // Barrier: waiting for the other workers
+    pthread_mutex_lock(&pool_mutex);
+    while (pool_busy > 0) {
+        pthread_cond_wait(&pool_done, &pool_mutex);
+    }
+    pool_parallel = 0;
+    pthread_mutex_unlock(&pool_mutex);
+
+    pool_flush();
+}
+
+/*! \brief Sends a message, inside a parallel section it is buffered
+ */
+void pool_send(context_t *ctx, int from, int to, double ts, void *msg, unsigned int size) {
+    GByteArray *outbound;
+    pool_record record;
+    guint       position;
+
+    if (!pool_parallel) {
+        frame_send(ctx, from, to, ts, msg, size);
+        return;
+    }
+
+    record.ctx  = ctx;
+    record.from = from;
+    record.to   = to;
+    record.ts   = ts;
+    record.size = size;
+
+    // The payload is padded, the following header stays aligned
+    outbound = pool_outbound[pool_worker_id];
+    position = outbound->len;
+    g_byte_array_set_size(outbound, position + sizeof(pool_record) + ((size + 7) & ~7u));
+    memcpy(outbound->data + position, &record, sizeof(pool_record));
+    memcpy(outbound->data + position + sizeof(pool_record), msg, size);
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,32 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "pool.c" description
+ *              -	Function prototypes
+ *              -	Some constants
+ *
+ ############################################################################################### */
+
+#ifndef __POOL_H
+#define __POOL_H
+
+#include "context.h"
+
+
+#define POOL_CHUNK    64        // Items handed out to a worker at a time
+#define POOL_ALIGN    64        // Per-worker data is aligned to a cache line (no false sharing)
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+void pool_init(int);
+void pool_restart();
+void pool_shutdown();
+int  pool_workers();
+int  pool_worker();
+void pool_run(void (*)(int, int, void *), int, void *);
+void pool_send(context_t *, int, int, double, void *, unsigned int);
+
+#endif /* __POOL_H */
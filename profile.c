@@ -0,0 +1,172 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Profiler of the LP: the wall-clock time of the run is split
+ *                      among some phases (see profile.h), the LP switches from
+ *                      a phase to another and the time since the last switch goes
+ *                      to the phase that is ending. The time is read from a
+ *                      monotonic cycle counter (the TSC on x86, otherwise the
+ *                      monotonic clock), scaled to seconds only in the reports
+ *              -	Used by the main thread of the LP only, the calls made
+ *                      before profile_init() (or by other threads, e.g. the
+ *                      replicas) are ignored
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "profile.h"
+
+
+static const char *profile_name[PROFILE_PHASES] = {
+    "startup", "topology", "computation", "epoch", "churn", "dispatch L/U", "dispatch R", "receive", "advance", "LP"
+};
+
+static pthread_t       profile_thread;                      // The only thread that is profiled
+static int             profile_enabled;
+static int             profile_current;                     // Phase being executed
+static uint64_t        profile_last;                        // Counter at the last switch
+static uint64_t        profile_spent[PROFILE_PHASES];       // Counts spent in each phase
+static long            profile_dispatched[PROFILE_PHASES];  // Model events dispatched in each phase
+static uint64_t        profile_origin;                      // Counter at profile_init()
+static struct timespec profile_origin_time;                 // Monotonic clock at profile_init()
+
+// Totals at the last report (see profile_report())
+static uint64_t        profile_spent_report[PROFILE_PHASES];
+static long            profile_dispatched_report;
+
+
+/*! \brief Monotonic cycle counter
+ */
+static inline uint64_t profile_counter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return(__rdtsc());
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+#endif
+}
+
+/*! \brief Seconds of a count, calibrated against the monotonic clock since profile_init()
+ */
+static double profile_scale() {
+    struct timespec now;
+    double          seconds;
+    uint64_t        counts;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    counts  = profile_counter() - profile_origin;
+    seconds = (double)(now.tv_sec - profile_origin_time.tv_sec) + (double)(now.tv_nsec - profile_origin_time.tv_nsec) / 1e9;
+    return(counts > 0 ? seconds / (double)counts : 0.0);
+}
+
+/*! \brief Starts the profiling of the calling thread, in the startup phase
+ */
+void profile_init() {
+    profile_thread  = pthread_self();
+    profile_enabled = 1;
+    profile_current = PROFILE_STARTUP;
+
+    clock_gettime(CLOCK_MONOTONIC, &profile_origin_time);
+    profile_origin = profile_counter();
+    profile_last   = profile_origin;
+}
+
+/*! \brief The LP moves to a phase, the previous one is returned (to go back to it)
+ */
+int profile_switch(int phase) {
+    uint64_t now;
+    int      previous;
+
+    if (!profile_enabled || !pthread_equal(pthread_self(), profile_thread)) {
+        return(phase);
+    }
+    now = profile_counter();
+    profile_spent[profile_current] += now - profile_last;
+    profile_last    = now;
+    previous        = profile_current;
+    profile_current = phase;
+    return(previous);
+}
+
+/*! \brief Model events dispatched in a phase
+ */
+void profile_events(int phase, long events) {
+    if (profile_enabled && pthread_equal(pthread_self(), profile_thread)) {
+        profile_dispatched[phase] += events;
+    }
+}
+
+/*! \brief A line with the time spent in each phase since the last report (as
+ *         a percentage), the events dispatched per second and the estimated
+ *         time to reach the end of the run (from the average timestep so far)
+ */
+void profile_report(FILE *out, double simclock, double end_clock) {
+    double scale, interval = 0.0, elapsed = 0.0, running, eta;
+    long   events = 0;
+    int    p;
+
+    if (!profile_enabled) {
+        return;
+    }
+    profile_switch(profile_current);
+    scale = profile_scale();
+
+    for (p = 0; p < PROFILE_PHASES; p++) {
+        interval += (double)(profile_spent[p] - profile_spent_report[p]) * scale;
+        elapsed  += (double)profile_spent[p] * scale;
+        events   += profile_dispatched[p];
+    }
+    running = elapsed - (double)profile_spent[PROFILE_STARTUP] * scale;
+    eta     = simclock > 0 ? running / simclock * (end_clock - simclock) : 0.0;
+
+    fprintf(out, "PROFILE %12.2f: elapsed %10.2fs, %10.0f events/s, ETA %10.2fs |", simclock, elapsed,
+            interval > 0 ? (double)(events - profile_dispatched_report) / interval : 0.0, eta);
+    for (p = 0; p < PROFILE_PHASES; p++) {
+        fprintf(out, " %s %5.1f%%", profile_name[p],
+                interval > 0 ? (double)(profile_spent[p] - profile_spent_report[p]) * scale / interval * 100.0 : 0.0);
+        profile_spent_report[p] = profile_spent[p];
+    }
+    fprintf(out, "\n");
+    profile_dispatched_report = events;
+}
+
+/*! \brief Time spent in each phase in the whole run
+ */
+void profile_summary(FILE *out) {
+    double scale, elapsed = 0.0, seconds;
+    int    p;
+
+    if (!profile_enabled) {
+        return;
+    }
+    profile_switch(profile_current);
+    scale = profile_scale();
+
+    for (p = 0; p < PROFILE_PHASES; p++) {
+        elapsed += (double)profile_spent[p] * scale;
+    }
+    fprintf(out, "### Profile        %12.2fs of wall-clock time\n", elapsed);
+    for (p = 0; p < PROFILE_PHASES; p++) {
+        seconds = (double)profile_spent[p] * scale;
+        fprintf(out, "###   %-12s %12.3fs %5.1f%%", profile_name[p], seconds, elapsed > 0 ? seconds / elapsed * 100.0 : 0.0);
+        if (profile_dispatched[p] > 0) {
+            fprintf(out, "  %ld events, %.0f events/s", profile_dispatched[p], seconds > 0 ? (double)profile_dispatched[p] / seconds : 0.0);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "### Synchronization (receive + advance) %5.1f%%\n",
+            elapsed > 0 ? (double)(profile_spent[PROFILE_RECEIVE] + profile_spent[PROFILE_ADVANCE]) * scale / elapsed * 100.0 : 0.0);
+    fflush(out);
+}
+
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,41 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "profile.c" description
+ *              -	Phases of the LP
+ *              -	Function prototypes
+ *
+ ############################################################################################### */
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include <stdio.h>
+
+
+// Phases of the LP, the wall-clock time of the run is split among them
+#define PROFILE_STARTUP         0           // Set-up, generation and registration of the SEs
+#define PROFILE_TOPOLOGY        1           // Loading of the graph topology
+#define PROFILE_COMPUTATION     2           // Generate_Computation_and_Interactions() (but the topology, epochs and churn)
+#define PROFILE_EPOCH           3           // Start of an epoch: folding of the churn, scans of the local SEs
+#define PROFILE_CHURN           4           // Activity of the SEs in the churn calendar
+#define PROFILE_DISPATCH_LU     5           // Sorting, grouping and dispatch of the link and unlink model events ('L', 'U')
+#define PROFILE_DISPATCH_R      6           // Grouping and dispatch of the request model events ('R')
+#define PROFILE_RECEIVE         7           // Blocked in GAIA_Receive()
+#define PROFILE_ADVANCE         8           // Blocked in GAIA_TimeAdvance()
+#define PROFILE_LP              9           // Everything else (unpacking, checkpoints, frames...)
+#define PROFILE_PHASES          10
+
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+void profile_init();
+int  profile_switch(int);
+void profile_events(int, long);
+void profile_report(FILE *, double, double);
+void profile_summary(FILE *);
+
+#endif /* __PROFILE_H */
@@ -0,0 +1,227 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Counter-based random numbers generator (Philox4x32-10).
+ *                      A random number is a function of (seed, SE, timestep,
+ *                      purpose, position in the stream): the same SE draws the
+ *                      same numbers whatever is the order of execution, in
+ *                      any thread and in any LP
+ *              -	The state of a generator (seed and positions) is an
+ *                      rng_t, each simulation context has its own one
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "rng.h"
+
+
+#define PHILOX_M0    0xD2511F53
+#define PHILOX_M1    0xCD9E8D57
+#define PHILOX_W0    0x9E3779B9
+#define PHILOX_W1    0xBB67AE85
+#define PHILOX_ROUNDS    10
+
+
+/*! \brief Reads the seed (first line of the seeds file, shared by all the LPs)
+ *         and allocates the stream positions of "keys" SEs
+ */
+void rng_init(rng_t *rng, char *seed_file, int keys) {
+    FILE *       fp;
+    unsigned int k0, k1;
+
+    if ((fp = fopen(seed_file, "r")) == NULL || fscanf(fp, "%u %u", &k0, &k1) != 2) {
+        fprintf(stdout, "FATAL ERROR, impossible to read the seed from: %s\n", seed_file);
+        exit(-1);
+    }
+    fclose(fp);
+    rng->key[0] = k0;
+    rng->key[1] = k1;
+
+    // The last stream is the global one
+    rng->streams  = keys + 1;
+    rng->position = (uint32_t *)calloc(rng->streams, sizeof(uint32_t));
+    rng->step     = (int *)malloc(sizeof(int) * rng->streams);
+    ASSERT((rng->position != NULL && rng->step != NULL), ("rng_init: malloc error"));
+    memset(rng->step, -1, sizeof(int) * rng->streams);
+}
+
+/*! \brief Releases the stream positions
+ */
+void rng_free(rng_t *rng) {
+    free(rng->position);
+    free(rng->step);
+    rng->position = NULL;
+    rng->step     = NULL;
+}
+
+/*! \brief The seed, that is all the state of the generator between two timesteps
+ *         (the positions in the streams restart at each timestep)
+ */
+void rng_get_key(const rng_t *rng, uint32_t *key) {
+    key[0] = rng->key[0];
+    key[1] = rng->key[1];
+}
+
+/*! \brief Replaces the seed (e.g. with the one of a checkpoint)
+ */
+void rng_set_key(rng_t *rng, const uint32_t *key) {
+    rng->key[0] = key[0];
+    rng->key[1] = key[1];
+    memset(rng->step, -1, sizeof(int) * rng->streams);
+}
+
+/*! \brief One Philox4x32-10 block: four 32 bits random words for the counter
+ */
+void rng_philox(const rng_t *rng, const uint32_t *counter, uint32_t *out) {
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = rng->key[0], k1 = rng->key[1];
+    uint64_t p0, p1;
+    int      r;
+
+    for (r = 0; r < PHILOX_ROUNDS; r++) {
+        p0  = (uint64_t)PHILOX_M0 * c0;
+        p1  = (uint64_t)PHILOX_M1 * c2;
+        c0  = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c2  = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1  = (uint32_t)p1;
+        c3  = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/*! \brief RNG_LANES Philox blocks at once, the lanes are independent and the
+ *         loops are vectorized by the compiler (no intrinsics are required)
+ */
+static void rng_philox_lanes(const rng_t *rng, uint32_t c[4][RNG_LANES]) {
+    uint32_t k0 = rng->key[0], k1 = rng->key[1];
+    uint64_t p0, p1;
+    uint32_t t0, t1, t2, t3;
+    int      r, l;
+
+    for (r = 0; r < PHILOX_ROUNDS; r++) {
+        for (l = 0; l < RNG_LANES; l++) {
+            p0      = (uint64_t)PHILOX_M0 * c[0][l];
+            p1      = (uint64_t)PHILOX_M1 * c[2][l];
+            t0      = (uint32_t)(p1 >> 32) ^ c[1][l] ^ k0;
+            t1      = (uint32_t)p1;
+            t2      = (uint32_t)(p0 >> 32) ^ c[3][l] ^ k1;
+            t3      = (uint32_t)p0;
+            c[0][l] = t0;
+            c[1][l] = t1;
+            c[2][l] = t2;
+            c[3][l] = t3;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+/*! \brief Stream of the SE "id" (or RNG_GLOBAL), restarted at each timestep
+ */
+static int rng_stream(rng_t *rng, int id, int step) {
+    int stream = (id == RNG_GLOBAL) ? rng->streams - 1 : id;
+
+    ASSERT((stream >= 0 && stream < rng->streams), ("rng_stream: unknown stream %d", id));
+    if (rng->step[stream] != step) {
+        rng->step[stream]     = step;
+        rng->position[stream] = 0;
+    }
+    return(stream);
+}
+
+/*! \brief Next 32 random bits of the stream of a SE in the given timestep
+ */
+uint32_t rng_next(rng_t *rng, int id, int step, enum RNG_PURPOSE purpose) {
+    int      stream = rng_stream(rng, id, step);
+    uint32_t position = rng->position[stream]++;
+    uint32_t counter[4], out[4];
+
+    counter[0] = (uint32_t)id;
+    counter[1] = (uint32_t)step;
+    counter[2] = (uint32_t)purpose;
+    counter[3] = position >> 2;
+    rng_philox(rng, counter, out);
+
+    return(out[position & 3]);
+}
+
+/*! \brief Uniform in (0, 1)
+ */
+double rng_uniform(rng_t *rng, int id, int step, enum RNG_PURPOSE purpose) {
+    return((rng_next(rng, id, step, purpose) + 0.5) * (1.0 / 4294967296.0));
+}
+
+/*! \brief Uniform integer in [min, max] (multiply and shift, the bias is
+ *         negligible for the ranges used by the simulator)
+ */
+int rng_integer(rng_t *rng, int id, int step, enum RNG_PURPOSE purpose, int min, int max) {
+    uint64_t range = (uint64_t)(max - min) + 1;
+
+    return(min + (int)((rng_next(rng, id, step, purpose) * range) >> 32));
+}
+
+/*! \brief Fills "out" with "n" random words of the stream, whole blocks are
+ *         computed RNG_LANES at a time. The position is first aligned to a block
+ */
+static void rng_batch(rng_t *rng, int id, int step, enum RNG_PURPOSE purpose, uint32_t *out, int n) {
+    int      stream = rng_stream(rng, id, step);
+    uint32_t block  = (rng->position[stream] + 3) >> 2;
+    uint32_t c[4][RNG_LANES];
+    int      i, l, w;
+
+    for (i = 0; i < n; i += 4 * RNG_LANES) {
+        for (l = 0; l < RNG_LANES; l++) {
+            c[0][l] = (uint32_t)id;
+            c[1][l] = (uint32_t)step;
+            c[2][l] = (uint32_t)purpose;
+            c[3][l] = block + l;
+        }
+        rng_philox_lanes(rng, c);
+
+        for (l = 0; l < RNG_LANES; l++) {
+            for (w = 0; w < 4 && i + 4 * l + w < n; w++) {
+                out[i + 4 * l + w] = c[w][l];
+            }
+        }
+        block += RNG_LANES;
+    }
+    rng->position[stream] = ((rng->position[stream] + 3) & ~3u) + (((uint32_t)n + 3) & ~3u);
+}
+
+/*! \brief "n" uniform values in (0, 1)
+ */
+void rng_uniform_batch(rng_t *rng, int id, int step, enum RNG_PURPOSE purpose, double *out, int n) {
+    uint32_t words[n];
+    int      i;
+
+    rng_batch(rng, id, step, purpose, words, n);
+    for (i = 0; i < n; i++) {
+        out[i] = (words[i] + 0.5) * (1.0 / 4294967296.0);
+    }
+}
+
+/*! \brief "n" uniform integers in [min, max]
+ */
+void rng_integer_batch(rng_t *rng, int id, int step, enum RNG_PURPOSE purpose, int *out, int n, int min, int max) {
+    uint64_t range = (uint64_t)(max - min) + 1;
+    uint32_t words[n];
+    int      i;
+
+    rng_batch(rng, id, step, purpose, words, n);
+    for (i = 0; i < n; i++) {
+        out[i] = min + (int)((words[i] * range) >> 32);
+    }
+}
+
+/*---------------------------------------------------------------------------*/
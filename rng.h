@@ -0,0 +1,57 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "rng.c" description
+ *              -	Function prototypes
+ *              -	Some constants
+ *
+ ############################################################################################### */
+
+#ifndef __RNG_H
+#define __RNG_H
+
+#include <stdint.h>
+
+
+#define RNG_GLOBAL    -1        // Stream shared by all the LPs (not owned by a SE)
+#define RNG_LANES     8         // Philox blocks computed together by the batch generation
+#define RNG_BATCH     64        // Suggested size of the batches drawn in the hot loops
+
+/* ************************************************************************ */
+/*                      Purposes of the random numbers                      */
+/* ************************************************************************ */
+enum RNG_PURPOSE {
+    RNG_BUILD,                  // Initial activity of the SEs
+    RNG_CHURN,                  // Activation and deactivation of the SEs
+    RNG_SELECT,                 // Choice of applicant and holder
+    RNG_FORWARD,                // Dissemination
+    RNG_ATTACH                  // New links of the (re)activated SEs
+};
+
+/*! \brief State of a generator: the seed and the position in the stream of each
+ *         SE in the current timestep
+ */
+typedef struct rng_t {
+    uint32_t  key[2];           // Seed, the same in all the LPs
+    uint32_t *position;         // Position (in words) in the stream of each SE for the current timestep
+    int *     step;             // Timestep of the position above
+    int       streams;          // Number of streams (SEs plus the global one)
+} rng_t;
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+void     rng_init(rng_t *, char *, int);
+void     rng_free(rng_t *);
+void     rng_get_key(const rng_t *, uint32_t *);
+void     rng_set_key(rng_t *, const uint32_t *);
+void     rng_philox(const rng_t *, const uint32_t *, uint32_t *);
+uint32_t rng_next(rng_t *, int, int, enum RNG_PURPOSE);
+double   rng_uniform(rng_t *, int, int, enum RNG_PURPOSE);
+int      rng_integer(rng_t *, int, int, enum RNG_PURPOSE, int, int);
+void     rng_uniform_batch(rng_t *, int, int, enum RNG_PURPOSE, double *, int);
+void     rng_integer_batch(rng_t *, int, int, enum RNG_PURPOSE, int *, int, int, int);
+
+#endif /* __RNG_H */
@@ -59,5 +59,13 @@
 //	(e.g. ping and migration messages)
 #define BUFFER_SIZE    1024 * 1024
 
+// Timesteps covered by the local queue of the model events
+//	the FLIGHT_TIME has to be smaller
+#define EVENTS_QUEUE_SIZE    4
+
+// Max size of a frame (model messages to the same LP, packed together)
+//	it has to be smaller than BUFFER_SIZE
+#define FRAME_SIZE     64 * 1024
+
 /***************** DEGREE DEPENDENT GOSSIP *********************************/
 #define DEGREE_DEPENDENT_GOSSIP_SUPPORT
@@ -4,7 +4,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <fcntl.h>
 #include <math.h>
 #include <ctype.h>
@@ -14,6 +16,12 @@
 #include <rnd.h>
 #include <gaia.h>
 #include "utils.h"
+#include "rng.h"
+#include "pool.h"
+#include "frame.h"
+#include "checkpoint.h"
+#include "profile.h"
+#include "context.h"
 #include "user_event_handlers.h"
 
 /*-------- G L O B A L     V A R I A B L E S --------------------------------*/
@@ -31,9 +39,8 @@ static char LP_HOST[64];      // Local hostname
 static char SIMA_HOST[64];    // SIMA execution host (fully qualified domain)
 static int  SIMA_PORT;        // SIMA execution port number
 
-// Time management variables
-double step,                  // Size of each timestep (expressed in time-units)
-       simclock        = 0.0; // Simulated time
+// Time management variables (the simulated time is in the context, see context.h)
+double step;                  // Size of each timestep (expressed in time-units)
 static int end_reached = 0;   // Control variable, false if the run is not finished
 
 // A single LP is responsible to show the runtime statistics
@@ -64,25 +71,23 @@ unsigned int   env_cache_size;                // Cache size of each node
 float          env_fixed_prob_threshold;      // Dissemination: fixed probability, probability threshold
 float          env_dandelion_stem_steps;      // Dissemination: number of stem and fluff phase
 int            env_perc_active_nodes_;        // Initial percentage of active node
+int            env_threads;                   // Worker threads of the LP
+int            env_lookups;                   // Concurrent lookups in each epoch
+int            env_bulk_links;                // Links of the topology built locally, without link messages
+int            env_checkpoint;                // Epochs between two checkpoints (0 none)
+int            env_restore;                   // Timestep of the checkpoint to resume from (0 none)
+int            env_sweep;                     // Configurations of the sweep (0 none)
+int            env_sweep_step;                // Timestep of the sweep, at the end of the warm-up
+int            env_replicas;                  // Replicas of the run in this process (0 none)
+char *         env_replica_graphs;            // Topology of each replica, "%d" is the replica (NULL the default one)
+int            env_metrics;                   // Per-epoch metrics stream (see metrics.h)
+int            env_profile;                   // Timesteps between two reports of the profiler (0 none)
+extern unsigned short env_max_ttl;            // Length of the epochs (see lunes.c)
 
 #ifdef DEGREE_DEPENDENT_GOSSIP_SUPPORT
 unsigned int   env_probability_function;      // Probability function for Degree Dependent Gossip
 double         env_function_coefficient;      // Coefficient of the probability function
 #endif
-int            applicant;
-int            holder;
-
-/* ************************************************************************ */
-/*                      Hash Tables                                         */
-/* ************************************************************************ */
-
-hash_t hash_table, *table = &hash_table; /* Global hash table, contains ALL the simulated entities */
-hash_t sim_table, *stable = &sim_table;  /* Local hash table, contains only the locally managed entities */
-
-long    countMessages=0;
-int     countEpochs=0;
-int     countDelivers=0;
-double  countSteps=0;
 /*---------------------------------------------------------------------------*/
 
 /* ************************************************************************ */
@@ -95,6 +100,100 @@ static se_list migr_list,
                *mlist = &migr_list;
 /*---------------------------------------------------------------------------*/
 
+/* ************************************************************************ */
+/*             Model Events of the Timestep                                 */
+/* ************************************************************************ */
+
+// The model events received in a timestep are dispatched all together at the
+//  EOS, in a canonical order that does not depend on the order of arrival
+//  (and then on the number of workers that sent them).
+//  The events of the next timesteps are kept in a ring of buckets (one for each
+//  timestep, see context.h): the messages among local SEs are enqueued there
+//  directly by the send path, only the remote ones go through GAIA
+typedef struct model_event {
+    int          from;                  // Sender
+    int          to;                    // Receiver (local SE)
+    int          phase;                 // See user_model_events_phase()
+    unsigned int seq;                   // Order of arrival
+    unsigned int offset;                // Payload position in events_data
+    unsigned int size;                  // Payload size
+} model_event;
+
+// Phase being dispatched (see dispatch_model_events())
+typedef struct dispatch_phase {
+    context_t *  ctx;
+    model_event *event;                 // First event of the phase
+} dispatch_phase;
+/*---------------------------------------------------------------------------*/
+
+
+/* ************************************************************************ */
+/*             Simulation Contexts                                          */
+/* ************************************************************************ */
+
+/*! \brief Initialization of a simulation context: directories of the SEs,
+ *         adjacency snapshot, random streams (the seed of the replica), lookups
+ *         and local queue of the model events. The model level state is
+ *         allocated by user_bootstrap_handler()
+ *  @param[in] graph: topology of the context (NULL the default one)
+ */
+static void context_init(context_t *ctx, int replica, char *seed_file, const char *graph) {
+    int h;
+
+    memset(ctx, 0, sizeof(context_t));
+    ctx->replica  = replica;
+    ctx->simclock = 0.0;
+    if (graph != NULL) {
+        snprintf(ctx->graph, sizeof(ctx->graph), "%s", graph);
+    }
+
+    // The identifiers are contiguous and therefore each directory is allocated here in a single block
+    ctx->table  = &ctx->hash_table;
+    ctx->stable = &ctx->sim_table;
+    ctx->csr    = &ctx->adj_csr;
+    hash_init(GSE, ctx->table, NSIMULATE * NLP, NSIMULATE * NLP);     // Global directory: all the SEs
+    hash_init(LSE, ctx->stable, NSIMULATE, NSIMULATE * NLP);          // Local directory: local SEs
+    csr_init(ctx->csr);                                               // Adjacency snapshot of the local SEs
+
+    // Counter-based streams of the model, keyed by SE and timestep (see rng.c),
+    //  each replica has its own seed
+    rng_init(&ctx->rng, seed_file, NSIMULATE * NLP);
+    ctx->rng.key[0] += replica;
+
+    ctx->applicant = (int *)malloc(sizeof(int) * env_lookups);
+    ctx->holder    = (int *)malloc(sizeof(int) * env_lookups);
+    ASSERT((ctx->applicant != NULL && ctx->holder != NULL), ("context_init: malloc error"));
+    memset(ctx->applicant, -1, sizeof(int) * env_lookups);
+    memset(ctx->holder, -1, sizeof(int) * env_lookups);
+
+    for (h = 0; h < EVENTS_QUEUE_SIZE; h++) {                         // Local queue of the model events
+        ctx->events_queue[h]      = g_array_new(FALSE, FALSE, sizeof(model_event));
+        ctx->events_queue_data[h] = g_byte_array_new();
+    }
+    ctx->events_groups = g_array_new(FALSE, FALSE, sizeof(int));
+}
+
+/*! \brief Releases a simulation context (the model level state is released
+ *         by user_shutdown_handler())
+ */
+static void context_free(context_t *ctx) {
+    int h;
+
+    for (h = 0; h < EVENTS_QUEUE_SIZE; h++) {
+        g_array_free(ctx->events_queue[h], TRUE);
+        g_byte_array_free(ctx->events_queue_data[h], TRUE);
+    }
+    g_array_free(ctx->events_groups, TRUE);
+
+    free(ctx->applicant);
+    free(ctx->holder);
+    rng_free(&ctx->rng);
+    csr_free(ctx->csr, ctx->stable);
+    hash_free(ctx->stable);
+    hash_free(ctx->table);
+}
+/*---------------------------------------------------------------------------*/
+
 
 /* *************************************************************************
  *                    M O D E L    D E F I N I T I O N
@@ -106,9 +205,9 @@ static se_list migr_list,
 /*! \brief Computation and Interactions generation: called at each timestep
  *         it will provide the model behavior.
  */
-static void Generate_Computation_and_Interactions(int total_SE) {
+static void Generate_Computation_and_Interactions(context_t *ctx, int total_SE) {
     // Call the appropriate user event handler
-    user_control_handler();
+    user_control_handler(ctx);
 }
 
 /*! \breif SEs initial generation: called once when global variables have been
@@ -117,7 +216,7 @@ static void Generate_Computation_and_Interactions(int total_SE) {
 static void Generate(int count) {
     int i;
 
-    // The local Simulated Entities are registered using the appropriate GAIA API
+    // The data structures are initialized in context_init(), the local Simulated Entities are registered using the appropriate GAIA API
     for (i = 0; i < count; i++) {
         // In this case every entity can be migrated
         GAIA_Register(MIGRABLE);
@@ -130,7 +229,7 @@ static void Generate(int count) {
 
 /*! \brief Performs the migration of the flagged Simulated Entities
  */
-static int UNUSED ScanMigrating() {
+static int UNUSED ScanMigrating(context_t *ctx) {
     // Current entity
     struct hash_node_t *se = NULL;
 
@@ -146,9 +245,8 @@ static int UNUSED ScanMigrating() {
     // Total size of the message that will be sent
     unsigned int message_size;
 
-    // Iterator to scan the whole state hashtable of entities
-    GHashTableIter iter;
-    gpointer       key, value;
+    // Neighbors of the migrating entity (local state, dynamic part)
+    adj_row *row;
 
 
     // The SEs to migrate have been already identified by GAIA
@@ -166,9 +264,10 @@ static int UNUSED ScanMigrating() {
         state_position = 0;
 
         // Dynamic part of the agents state
+        row = &se->data->neighbors;
         //
-        // The hashtable is empty
-        if (se->data->state == NULL) {
+        // The set of neighbors is empty
+        if (row->count == 0) {
             #ifdef DEBUG
             fprintf(stdout, "ID: %d is empty\n", se->data->key);
             fflush(stdout);
@@ -178,41 +277,24 @@ static int UNUSED ScanMigrating() {
         // Copying the local state of the migrating entity in the payload of the migration message
         //  for each record in the entity state a new record is appended in the dynamic part
         //  of the migration message
-        if (se->data->state != NULL) {
+        for (state_position = 0; state_position < (int)row->count; state_position++) {
+            m.migration_dynamic.records[state_position] = row->record[state_position];
             #ifdef DEBUG
-            int tmp = 0;
+            fprintf(stdout, "%12.2f node: [%5d] migration, copied key: %d, (%4d/%4d)\n", ctx->simclock, se->data->key, m.migration_dynamic.records[state_position].key, state_position + 1, row->count);
+            fflush(stdout);
             #endif
-
-            // Hashtable iterator
-            g_hash_table_iter_init(&iter, se->data->state);
-
-            while (g_hash_table_iter_next(&iter, &key, &value)) {
-                m.migration_dynamic.records[state_position].key      = *(unsigned int *)key;
-                m.migration_dynamic.records[state_position].elements = *((value_element *)value);
-                #ifdef DEBUG
-                tmp++;
-
-                fprintf(stdout, "%12.2f node: [%5d] migration, copied key: %d, (%4d/%4d)\n", simclock, se->data->key, m.migration_dynamic.records[state_position].key, tmp, g_hash_table_size(se->data->state));
-
-                fflush(stdout);
-                #endif
-
-                state_position++;
-            }
         }
+        m.migration_static.dyn_records = state_position;
 
-        // It is time to clean up the hash table of the migrated node
-        if (se->data->state != NULL) {
-            // In the hash table creation it has been provided the cleaning function that is g_free ()
-            g_hash_table_destroy(se->data->state);
-        }
+        // It is time to clean up the state of the migrated node
+        adj_row_free(row);
 
         // Calculating the real size of the migration message
-        message_size = sizeof(struct _migration_static_part);
+        message_size = sizeof(struct _migration_static_part) + m.migration_static.dyn_records * sizeof(struct state_element);
 
         if (message_size >= BUFFER_SIZE) {
             // I'm trying to send a message that is larger than the buffer
-            fprintf(stdout, "%12.2f node: FATAL ERROR, trying to send a message (migration) that is larger than: %d !\n", simclock, BUFFER_SIZE);
+            fprintf(stdout, "%12.2f node: FATAL ERROR, trying to send a message (migration) that is larger than: %d !\n", ctx->simclock, BUFFER_SIZE);
             fflush(stdout);
             exit(-1);
         }
@@ -221,7 +303,7 @@ static int UNUSED ScanMigrating() {
         GAIA_Migrate(se->data->key, (void *)&m, message_size);
 
         // Removing the migrated SE from the local list of migrating nodes
-        hash_delete(LSE, stable, se->data->key);
+        hash_delete(LSE, ctx->stable, se->data->key);
     }
 
     // Returning the number of migrated SE (for statistics)
@@ -237,13 +319,13 @@ static int UNUSED ScanMigrating() {
 /*! \brief Upon arrival of a model level event, firstly we have to validate it
  *         and only in the following the appropriate handler will be called
  */
-struct hash_node_t *validation_model_events(int id, int to, Msg *msg) {
+struct hash_node_t *validation_model_events(context_t *ctx, int id, int to, Msg *msg) {
     struct hash_node_t *node;
 
     // The receiver has to be a locally manager Simulated Entity, let's check!
-    if (!(node = hash_lookup(stable, to)))  {
+    if (!(node = hash_lookup(ctx->stable, to)))  {
         // The receiver is not managed by this LP, it is really a fatal error
-        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] is NOT in this LP!\n", simclock, to);
+        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] is NOT in this LP!\n", ctx->simclock, to);
         fflush(stdout);
         exit(-1);
     }else {
@@ -254,30 +336,30 @@ struct hash_node_t *validation_model_events(int id, int to, Msg *msg) {
 /*! \brief A new SE has been created, we have to insert it into the global
  *      and local hashtables, the correct key to use is the sender's ID
  */
-static void register_event_handler(int id, int lp) {
+static void register_event_handler(context_t *ctx, int id, int lp) {
     hash_node_t *node;
 
     // In every case the new node has to be inserted in the global hash table
     //  containing all the Simulated Entities
-    node = hash_insert(GSE, table, NULL, id, lp);
+    node = hash_insert(GSE, ctx->table, NULL, id, lp);
     if (node) {
         // If the SMH is local then it has to be inserted also in the local
         //  hashtable and some extra management is required
         if (lp == LPID) {
             // Call the appropriate user event handler
-            user_register_event_handler(node, id);
+            user_register_event_handler(ctx, node, id);
 
             // Inserting it in the table of local SEs
-            if (!hash_insert(LSE, stable, node->data, node->data->key, LPID)) {
+            if (!hash_insert(LSE, ctx->stable, node->data, node->data->key, LPID)) {
                 // Unable to allocate memory for local SEs
-                fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] impossible to add new elements to the hash table of local entities\n", simclock, id);
+                fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] impossible to add new elements to the hash table of local entities\n", ctx->simclock, id);
                 fflush(stdout);
                 exit(-1);
             }
         }
     }else {
         // The model is unable to add the new SE in the global hash table
-        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] impossible to add new elements to the global hash table\n", simclock, id);
+        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] impossible to add new elements to the global hash table\n", ctx->simclock, id);
         fflush(stdout);
         exit(-1);
     }
@@ -287,23 +369,23 @@ static void register_event_handler(int id, int lp) {
 
 /*! \brief Manages the "migration notification" of local SEs (i.e. allocated in this LP)
  */
-static void notify_migration_event_handler(int id, int to) {
+static void notify_migration_event_handler(context_t *ctx, int id, int to) {
     hash_node_t *node;
 
     #ifdef DEBUG
-    fprintf(stdout, "%12.2f agent: [%5d] is going to be migrated to LP [%5d]\n", simclock, id, to);
+    fprintf(stdout, "%12.2f agent: [%5d] is going to be migrated to LP [%5d]\n", ctx->simclock, id, to);
     #endif
 
     // The GAIA framework has decided that a local SE has to be migrated,
     //  the migration can NOT be executed immediately because the SE
     //  could be the destination of some "in flight" messages
-    if ((node = hash_lookup(table, id)))  {
+    if ((node = hash_lookup(ctx->table, id)))  {
         /* Now it is updated the list of SEs that are enabled to migrate (flagged) */
         list_add(mlist, node);
 
         node->data->lp = to;
         // Call the appropriate user event handler
-        user_notify_migration_event_handler();
+        user_notify_migration_event_handler(ctx);
     }
     // Just before the end of the current timestep, the migration list will be emptied
     //  and the pending migrations will be executed
@@ -312,16 +394,16 @@ static void notify_migration_event_handler(int id, int to) {
 /*! \brief Manages the "migration notification" of external SEs
  *         (that is, NOT allocated in the local LP).
  */
-static void notify_ext_migration_event_handler(int id, int to) {
+static void notify_ext_migration_event_handler(context_t *ctx, int id, int to) {
     hash_node_t *node;
 
     // A migration that does not directly involve the local LP is going to happen in
     //  the simulation. In some special cases the local LP has to take care of
     //  this information
-    if ((node = hash_lookup(table, id)))  {
+    if ((node = hash_lookup(ctx->table, id)))  {
         node->data->lp = to;                // Destination LP of the migration
         // Call the appropriate user event handler
-        user_notify_ext_migration_event_handler();
+        user_notify_ext_migration_event_handler(ctx);
     }
 }
 
@@ -329,22 +411,508 @@ static void notify_ext_migration_event_handler(int id, int to) {
  *       This handler is executed when a migration message is received and
  *       therefore a new SE has to be accomodated in the local LP.
  */
-static void  migration_event_handler(int id, Msg *msg) {
+static void  migration_event_handler(context_t *ctx, int id, MigrMsg *msg) {
     hash_node_t *node;
 
     #ifdef DEBUG
-    fprintf(stdout, "%12.2f agent: [%5d] has been migrated in this LP\n", simclock, id);
+    fprintf(stdout, "%12.2f agent: [%5d] has been migrated in this LP\n", ctx->simclock, id);
     #endif
 
-    if ((node = hash_lookup(table, id))) {
+    if ((node = hash_lookup(ctx->table, id))) {
         // Inserting the new SE in the local table
-        hash_insert(LSE, stable, node->data, node->data->key, LPID);
+        hash_insert(LSE, ctx->stable, node->data, node->data->key, LPID);
 
         // Call the appropriate user event handler
-        user_migration_event_handler(node, id, msg);
+        user_migration_event_handler(ctx, node, id, msg);
+    }
+}
+
+/*! \brief Enqueues a model event in the bucket of its timestep, it will be
+ *         dispatched at the end of that timestep
+ */
+static void enqueue_model_event(context_t *ctx, int from, int to, double ts, Msg *msg, int size) {
+    model_event event;
+    GArray *    queue;
+    GByteArray *data;
+    int         slot = (int)ts % EVENTS_QUEUE_SIZE;
+
+    // First some checks for validation
+    validation_model_events(ctx, from, to, msg);
+
+    if (((int)ts < (int)ctx->simclock) || ((int)ts - (int)ctx->simclock >= EVENTS_QUEUE_SIZE)) {
+        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] event at %.2f out of the local queue, see EVENTS_QUEUE_SIZE in sim-parameters.h\n", ctx->simclock, to, ts);
+        fflush(stdout);
+        exit(-1);
+    }
+    queue = ctx->events_queue[slot];
+    data  = ctx->events_queue_data[slot];
+
+    event.from   = from;
+    event.to     = to;
+    event.phase  = user_model_events_phase(msg);
+    event.seq    = queue->len;
+    event.offset = data->len;
+    event.size   = size;
+
+    // The payloads are kept aligned
+    g_byte_array_set_size(data, event.offset + MSG_PADDED(size));
+    memcpy(data->data + event.offset, msg, size);
+    g_array_append_val(queue, event);
+}
+
+/*! \brief A model event received from GAIA, for the current timestep
+ */
+static void buffer_model_event(context_t *ctx, int from, int to, Msg *msg, int size) {
+    enqueue_model_event(ctx, from, to, ctx->simclock, msg, size);
+}
+
+/*! \brief Canonical order of the model events: phase, receiver, sender, content.
+ *         The arrival order is used only among identical messages
+ */
+static gint compare_model_events(gconstpointer a, gconstpointer b, gpointer data) {
+    const model_event *x = a, *y = b;
+    int                cmp;
+
+    if (x->phase != y->phase) { return(x->phase - y->phase); }
+    if (x->to != y->to) { return(x->to - y->to); }
+    if (x->from != y->from) { return(x->from - y->from); }
+    if (x->size != y->size) { return((int)x->size - (int)y->size); }
+    if ((cmp = memcmp((guint8 *)data + x->offset, (guint8 *)data + y->offset, x->size))) { return(cmp); }
+    return((int)x->seq - (int)y->seq);
+}
+
+/*! \brief Worker task: all the events of the receivers in [first, last)
+ */
+static void dispatch_model_events_task(int first, int last, void *arg) {
+    context_t *  ctx   = ((dispatch_phase *)arg)->ctx;
+    model_event *phase = ((dispatch_phase *)arg)->event;
+    int *        groups = (int *)ctx->events_groups->data;
+    model_event *event;
+    hash_node_t *node;
+    int          g, e;
+
+    for (g = first; g < last; g++) {
+        node = hash_lookup(ctx->stable, phase[groups[g]].to);
+
+        for (e = groups[g]; e < groups[g + 1]; e++) {
+            event = &phase[e];
+            user_model_events_handler(ctx, event->to, event->from, (Msg *)(ctx->events_data->data + event->offset), node);
+        }
+    }
+}
+
+/*! \brief Dispatches the model events of the timestep, a phase at a time.
+ *         In each phase the receivers are shared among the workers, all the
+ *         events of a receiver are executed by the same worker
+ */
+static void dispatch_model_events(context_t *ctx) {
+    dispatch_phase phase;
+    model_event *  event;
+    guint          first, last;
+    int            group, previous;
+
+    // The bucket of the current timestep
+    ctx->events      = ctx->events_queue[(int)ctx->simclock % EVENTS_QUEUE_SIZE];
+    ctx->events_data = ctx->events_queue_data[(int)ctx->simclock % EVENTS_QUEUE_SIZE];
+    event       = (model_event *)ctx->events->data;
+
+    if (ctx->events->len == 0) {
+        return;
+    }
+    // Sorting and grouping are part of the dispatch (the sort goes to the first phase)
+    previous = profile_switch(PROFILE_DISPATCH_LU);
+    g_array_sort_with_data(ctx->events, compare_model_events, ctx->events_data->data);
+
+    for (first = 0; first < ctx->events->len; first = last) {
+        // Events of the phase, grouped by receiver
+        profile_switch(event[first].phase == 0 ? PROFILE_DISPATCH_LU : PROFILE_DISPATCH_R);
+        g_array_set_size(ctx->events_groups, 0);
+        for (last = first; last < ctx->events->len && event[last].phase == event[first].phase; last++) {
+            if (last == first || event[last].to != event[last - 1].to) {
+                group = last - first;
+                g_array_append_val(ctx->events_groups, group);
+            }
+        }
+        group = last - first;
+        g_array_append_val(ctx->events_groups, group);
+
+        phase.ctx   = ctx;
+        phase.event = &event[first];
+        pool_run(dispatch_model_events_task, ctx->events_groups->len - 1, &phase);
+        profile_events(event[first].phase == 0 ? PROFILE_DISPATCH_LU : PROFILE_DISPATCH_R, last - first);
+    }
+    profile_switch(previous);
+
+    g_array_set_size(ctx->events, 0);
+    g_byte_array_set_size(ctx->events_data, 0);
+}
+
+
+/* ************************************************************************ */
+/*                  C H E C K P O I N T S                                   */
+/* ************************************************************************ */
+
+// A checkpoint is taken at the EOS of the first timestep of an epoch, before
+//  its model events are dispatched: all the messages of the timestep are in the
+//  local queue and none is in flight. A resumed run skips the timesteps before
+//  the checkpoint (but the registration of the SEs) and then it reads the state
+//  of the LP in place of computing it, see checkpoint.c for the file format
+
+/*! \brief Header and file name of the checkpoint of the LP at the current timestep
+ */
+static void checkpoint_identify(context_t *ctx, checkpoint_header *header, char *name, size_t size) {
+    memset(header, 0, sizeof(checkpoint_header));
+    memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+    header->version    = CHECKPOINT_VERSION;
+    header->lp         = LPID;
+    header->lps        = NLP;
+    header->entities   = NSIMULATE;
+    header->step       = (int)ctx->simclock;
+    header->max_ttl    = env_max_ttl;
+    header->lookups    = env_lookups;
+    header->cache_size = env_cache_size;
+
+    snprintf(name, size, "%sCHECKPOINT_%03d_%d.dat", TESTNAME, LPID, (int)ctx->simclock);
+}
+
+/*! \brief Writes the state of the LP: seed of the random streams, counters,
+ *         lookups of the epoch, hot fields of all the SEs, neighbors of the
+ *         local SEs, pending model events and (see user_checkpoint_save_handler())
+ *         the state of the model level
+ */
+static void save_checkpoint(context_t *ctx, int tot) {
+    checkpoint_t          ck;
+    checkpoint_header     header;
+    char                  name[1024];
+    uint32_t              key[2];
+    hash_node_t *         node;
+    adj_row *             row;
+    GByteArray *          data;
+    unsigned int          i;
+    int                   h;
+
+    checkpoint_identify(ctx, &header, name, sizeof(name));
+    checkpoint_create(&ck, name, &header);
+
+    rng_get_key(&ctx->rng, key);
+    checkpoint_put(&ck, key, sizeof(key));
+    checkpoint_put(&ck, &tot, sizeof(tot));
+    checkpoint_put(&ck, &ctx->countMessages, sizeof(ctx->countMessages));
+    checkpoint_put(&ck, &ctx->countEpochs, sizeof(ctx->countEpochs));
+    checkpoint_put(&ck, &ctx->countDelivers, sizeof(ctx->countDelivers));
+    checkpoint_put(&ck, &ctx->countSteps, sizeof(ctx->countSteps));
+    checkpoint_put(&ck, ctx->applicant, sizeof(int) * env_lookups);
+    checkpoint_put(&ck, ctx->holder, sizeof(int) * env_lookups);
+
+    checkpoint_put(&ck, ctx->table->status, sizeof(unsigned char) * ctx->table->keys);
+    checkpoint_put(&ck, ctx->table->num_neighbors, sizeof(unsigned short) * ctx->table->keys);
+
+    // The rows are written in their order, the random choices among the
+    //  neighbors depend on it
+    for (h = 0; h < ctx->stable->count; h++) {
+        node = &ctx->stable->node[h];
+        row  = &node->data->neighbors;
+        checkpoint_put(&ck, &node->data->key, sizeof(int));
+        checkpoint_put(&ck, &node->data->internal_timer, sizeof(int));
+        checkpoint_put(&ck, &row->count, sizeof(unsigned int));
+        for (i = 0; i < row->count; i++) {
+            checkpoint_put(&ck, &row->record[i].key, sizeof(unsigned int));
+            checkpoint_put(&ck, &row->record[i].elements.value, sizeof(unsigned int));
+        }
+    }
+
+    // From the current timestep on
+    for (h = 0; h < EVENTS_QUEUE_SIZE; h++) {
+        checkpoint_put_array(&ck, ctx->events_queue[((int)ctx->simclock + h) % EVENTS_QUEUE_SIZE]);
+        data = ctx->events_queue_data[((int)ctx->simclock + h) % EVENTS_QUEUE_SIZE];
+        checkpoint_put(&ck, &data->len, sizeof(guint));
+        checkpoint_put(&ck, data->data, data->len);
+    }
+
+    user_checkpoint_save_handler(ctx, &ck);
+    checkpoint_close(&ck);
+
+    fprintf(stdout, "%12.2f checkpoint written in %s\n", ctx->simclock, name);
+    fflush(stdout);
+}
+
+/*! \brief Reads the state of the LP written by save_checkpoint(), the
+ *         checkpoint has to be of the same run (see checkpoint_open())
+ */
+static void restore_checkpoint(context_t *ctx, int *tot) {
+    checkpoint_t          ck;
+    checkpoint_header     header;
+    char                  name[1024];
+    uint32_t              key[2];
+    hash_node_t *         node,
+                *         neighbor;
+    value_element         val;
+    GByteArray *          data;
+    unsigned int          i, count, neighbor_key;
+    int                   h, id;
+
+    checkpoint_identify(ctx, &header, name, sizeof(name));
+    checkpoint_open(&ck, name, &header);
+
+    checkpoint_get(&ck, key, sizeof(key));
+    rng_set_key(&ctx->rng, key);
+    checkpoint_get(&ck, tot, sizeof(int));
+    checkpoint_get(&ck, &ctx->countMessages, sizeof(ctx->countMessages));
+    checkpoint_get(&ck, &ctx->countEpochs, sizeof(ctx->countEpochs));
+    checkpoint_get(&ck, &ctx->countDelivers, sizeof(ctx->countDelivers));
+    checkpoint_get(&ck, &ctx->countSteps, sizeof(ctx->countSteps));
+    checkpoint_get(&ck, ctx->applicant, sizeof(int) * env_lookups);
+    checkpoint_get(&ck, ctx->holder, sizeof(int) * env_lookups);
+
+    checkpoint_get(&ck, ctx->table->status, sizeof(unsigned char) * ctx->table->keys);
+    checkpoint_get(&ck, ctx->table->num_neighbors, sizeof(unsigned short) * ctx->table->keys);
+
+    for (h = 0; h < ctx->stable->count; h++) {
+        checkpoint_get(&ck, &id, sizeof(int));
+        if ((node = hash_lookup(ctx->stable, id)) == NULL) {
+            fprintf(stdout, "%12.2f FATAL ERROR, [%5d] in the checkpoint is not a local SE\n", ctx->simclock, id);
+            fflush(stdout);
+            exit(-1);
+        }
+        checkpoint_get(&ck, &node->data->internal_timer, sizeof(int));
+
+        // The rows are rebuilt from scratch, in the same order
+        adj_row_free(&node->data->neighbors);
+        adj_row_init(&node->data->neighbors);
+        checkpoint_get(&ck, &count, sizeof(unsigned int));
+        for (i = 0; i < count; i++) {
+            checkpoint_get(&ck, &neighbor_key, sizeof(unsigned int));
+            checkpoint_get(&ck, &val.value, sizeof(unsigned int));
+            if ((neighbor = hash_lookup(ctx->table, val.value)) == NULL) {
+                fprintf(stdout, "%12.2f FATAL ERROR, [%5d] neighbor %u in the checkpoint does NOT exist!\n", ctx->simclock, id, val.value);
+                fflush(stdout);
+                exit(-1);
+            }
+            val.node = neighbor;
+            adj_row_insert(ctx->csr, &node->data->neighbors, neighbor_key, &val);
+        }
+    }
+    csr_fold(ctx->csr, ctx->stable);
+
+    for (h = 0; h < EVENTS_QUEUE_SIZE; h++) {
+        checkpoint_get_array(&ck, ctx->events_queue[((int)ctx->simclock + h) % EVENTS_QUEUE_SIZE]);
+        data = ctx->events_queue_data[((int)ctx->simclock + h) % EVENTS_QUEUE_SIZE];
+        checkpoint_get(&ck, &i, sizeof(guint));
+        g_byte_array_set_size(data, i);
+        checkpoint_get(&ck, data->data, i);
+    }
+
+    user_checkpoint_restore_handler(ctx, &ck);
+    checkpoint_close(&ck);
+
+    fprintf(stdout, "%12.2f resumed from the checkpoint %s\n", ctx->simclock, name);
+    fflush(stdout);
+}
+
+
+/*! \brief Final statistics of the run
+ */
+static void print_statistics(context_t *ctx, FILE *out, int tot) {
+    // Totals of the statistics collected by the workers
+    user_statistics_handler(ctx, out);
+
+    fprintf(out, "\n\n");
+    fprintf(out, "### Termination condition reached (%d)\n", tot);
+    fprintf(out, "### Clock           %12.2f\n", ctx->simclock);
+    fprintf(out, "Message received %d times in %d simulations sending %ld messages delivered %ld per epoch. Total steps: %lf, average %lf\n",  ctx->countDelivers, ctx->countEpochs, ctx->countMessages, ctx->countMessages/ctx->countEpochs, ctx->countSteps, ctx->countSteps/ctx->countDelivers);// / countEpochs);
+    fflush(out);
+}
+
+/*! \brief Runs a context up to the end, without GAIA: all its model events have
+ *         to be local (a single LP). The same steps of the main loop, but the GAIA ones
+ */
+static void run_standalone(context_t *ctx) {
+    for (;;) {
+        dispatch_model_events(ctx);
+        if (ctx->simclock >= env_end_clock) {
+            break;
+        }
+        if (ctx->simclock < (env_end_clock - FLIGHT_TIME)) {
+            Generate_Computation_and_Interactions(ctx, NSIMULATE * NLP);
+        }
+        ctx->simclock += step;
+    }
+}
+
+
+/* ************************************************************************ */
+/*                  S W E E P                                               */
+/* ************************************************************************ */
+
+// A sweep runs the measurement phase of many configurations (see user_sweep_handler())
+//  after a single warm-up: at the EOS of env_sweep_step, before its model events are
+//  dispatched, the LP forks a child for each configuration but the first one, that
+//  is run by the LP itself. The children share the warmed-up state copy-on-write.
+//  With a single LP all the model events are local (see frame.c) and then the
+//  children advance the time by themselves, without GAIA. The output of each
+//  child goes in its own file
+
+static pid_t *sweep_children;           // Child of each configuration (the first is the LP)
+
+/*! \brief Measurement phase of a configuration, in a child of the LP
+ */
+static void sweep_child(context_t *ctx, int configuration, int tot) {
+    char name[1024];
+
+    snprintf(name, sizeof(name), "%sSWEEP_%02d.log", TESTNAME, configuration);
+    if (freopen(name, "w", stdout) == NULL) {
+        fprintf(stderr, "FATAL ERROR, impossible to create the output of the sweep: %s\n", name);
+        _exit(-1);
+    }
+
+    // Only the calling thread survives to fork()
+    pool_restart();
+    user_sweep_handler(ctx, configuration);
+
+    run_standalone(ctx);
+    print_statistics(ctx, stdout, tot);
+    user_shutdown_handler(ctx);
+
+    fflush(NULL);
+    _exit(0);
+}
+
+/*! \brief Forks the children of the sweep, the LP goes on with the first configuration
+ */
+static void sweep_fork(context_t *ctx, int tot) {
+    int k;
+
+    sweep_children = (pid_t *)malloc(sizeof(pid_t) * env_sweep);
+    ASSERT((sweep_children != NULL), ("sweep_fork: malloc error"));
+
+    // The buffered output would be written by the children too
+    fflush(NULL);
+
+    for (k = 1; k < env_sweep; k++) {
+        if ((sweep_children[k] = fork()) == -1) {
+            fprintf(stdout, "%12.2f FATAL ERROR, impossible to fork the configuration %d of the sweep\n", ctx->simclock, k);
+            fflush(stdout);
+            exit(-1);
+        }
+        if (sweep_children[k] == 0) {
+            sweep_child(ctx, k, tot);
+        }
+    }
+    user_sweep_handler(ctx, 0);
+}
+
+/*! \brief Waits for the children of the sweep (if any)
+ */
+static void sweep_wait() {
+    int k, status;
+
+    for (k = 1; sweep_children != NULL && k < env_sweep; k++) {
+        if (waitpid(sweep_children[k], &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stdout, "FATAL ERROR, the configuration %d of the sweep failed\n", k);
+        }else {
+            fprintf(stdout, "### Sweep configuration %d: see %sSWEEP_%02d.log\n", k, TESTNAME, k);
+        }
+    }
+    fflush(stdout);
+}
+/*---------------------------------------------------------------------------*/
+
+
+/* ************************************************************************ */
+/*                  R E P L I C A S                                         */
+/* ************************************************************************ */
+
+// The replicas of a run (see REPLICAS) are executed in this process, each one in
+//  its own context (see context.h) and with its own seed. As for the sweep there
+//  is a single LP and then GAIA is not needed: the registration of the SEs and the
+//  advance of the time are done here. Each thread takes the next replica to run,
+//  the statistics of a replica are buffered and printed at the end, in order
+
+static volatile gint replicas_next;     // First replica not yet taken
+static char *        replicas_seed;     // Seeds file
+static char **       replicas_output;   // Statistics of each replica
+static size_t *      replicas_length;
+
+/*! \brief A whole run of a replica
+ */
+static void replica_run(int replica) {
+    context_t context, *ctx = &context;
+    char      graph[1024];
+    FILE *    out;
+    int       i;
+
+    if (env_replica_graphs != NULL) {
+        snprintf(graph, sizeof(graph), env_replica_graphs, replica);
+    }
+    context_init(ctx, replica, replicas_seed, env_replica_graphs != NULL ? graph : NULL);
+
+    // The SEs are registered in the same order of GAIA
+    for (i = 0; i < NSIMULATE; i++) {
+        register_event_handler(ctx, NSIMULATE * LPID + i, LPID);
     }
+    user_bootstrap_handler(ctx);
+
+    run_standalone(ctx);
+
+    if ((out = open_memstream(&replicas_output[replica], &replicas_length[replica])) == NULL) {
+        fprintf(stdout, "FATAL ERROR, impossible to buffer the statistics of the replica %d\n", replica);
+        fflush(stdout);
+        exit(-1);
+    }
+    print_statistics(ctx, out, 0);
+    fclose(out);
+
+    user_shutdown_handler(ctx);
+    context_free(ctx);
 }
 
+/*! \brief Thread running the replicas
+ */
+static void *replicas_main(void UNUSED *arg) {
+    int replica;
+
+    while ((replica = g_atomic_int_add(&replicas_next, 1)) < env_replicas) {
+        replica_run(replica);
+    }
+    return(NULL);
+}
+
+/*! \brief Runs all the replicas, env_threads at a time
+ */
+static void replicas_run(char *seed_file) {
+    pthread_t *threads;
+    int        k, count = MIN(env_threads, env_replicas);
+
+    replicas_seed   = seed_file;
+    replicas_output = (char **)calloc(env_replicas, sizeof(char *));
+    replicas_length = (size_t *)calloc(env_replicas, sizeof(size_t));
+    threads         = (pthread_t *)malloc(sizeof(pthread_t) * count);
+    ASSERT((replicas_output != NULL && replicas_length != NULL && threads != NULL), ("replicas_run: malloc error"));
+
+    // The calling thread is the first one
+    for (k = 1; k < count; k++) {
+        if (pthread_create(&threads[k], NULL, replicas_main, NULL) != 0) {
+            fprintf(stdout, "FATAL ERROR, impossible to start the thread %d of the replicas\n", k);
+            fflush(stdout);
+            exit(-1);
+        }
+    }
+    replicas_main(NULL);
+    for (k = 1; k < count; k++) {
+        pthread_join(threads[k], NULL);
+    }
+
+    for (k = 0; k < env_replicas; k++) {
+        fprintf(stdout, "\n### Replica %d\n", k);
+        fwrite(replicas_output[k], 1, replicas_length[k], stdout);
+        free(replicas_output[k]);
+    }
+    fflush(stdout);
+
+    free(threads);
+    free(replicas_output);
+    free(replicas_length);
+}
 /*---------------------------------------------------------------------------*/
 
 
@@ -403,14 +971,18 @@ int main(int argc, char *argv[]) {
     int loc,                            // Number of messages with local destination (intra-LP)
         rem,                            // Number of messages with remote destination (extra-LP)
         migr;                           // Number of executed migrations
+
+    int phase;                          // Phase of the LP before a blocking call (see profile.h)
     //int t;                              // Total number of messages (local + remote)
 
     double Ts;                          // Current timestep
     Msg *  msg;                         // Generic message
 
+    context_t context,                  // Simulation context of the LP
+              *ctx = &context;
+
     //int migrated_in_this_step;          // Number of entities migrated in this step, in the local LP
 
-    struct hash_node_t *tmp_node;       // Tmp variable, a node in the hash table
     char *dat_filename, *tmp_filename;  // File descriptors for simulation traces
 
     // Time measurement
@@ -441,6 +1013,31 @@ int main(int argc, char *argv[]) {
     // (e.g. the GAIA parameters and many others)
     user_environment_handler();
 
+    // The profiler starts here, everything up to the first EOS is the start-up
+    if (env_profile > 0) {
+        profile_init();
+    }
+
+    // Worker threads of this LP (the main thread is the first one), the
+    //  replicas use the threads to run many replicas at a time
+    pool_init(env_replicas > 0 ? 1 : env_threads);
+
+    // The replicas of the run, without GAIA (see replicas_run()): a single LP,
+    //  all the model messages are delivered locally
+    if (env_replicas > 0) {
+        step = 1.0;
+        frame_init(NLP, 0, 1, enqueue_model_event);
+        replicas_run(rnd_file);
+        pool_shutdown();
+
+        // Creating the "finished file" that is used by some scripts
+        tmp_filename = malloc(256);
+        snprintf(tmp_filename, 256, "%d.finished", LPID);
+        finished_fp = fopen(tmp_filename, "w");
+        fclose(finished_fp);
+        return(0);
+    }
+
     /*
      *      Set-up of the GAIA framework
      *
@@ -460,6 +1057,11 @@ int main(int argc, char *argv[]) {
     // it retuns the size of a step
     step = GAIA_GetStep();
 
+    // Aggregation of the model messages and local delivery (it needs the LPID
+    //  assigned by GAIA), GAIA needs to see each interaction to take its
+    //  migration decisions
+    frame_init(NLP, LPID, !((env_migration > 0) && (env_migration < 4)), enqueue_model_event);
+
     // Due to synchronization constraints The FLIGHT_TIME has to be bigger than the timestep size
     if (FLIGHT_TIME < step) {
         fprintf(stdout, "FATAL ERROR, the FLIGHT_TIME (%8.2f) is less than the timestep size (%8.2f)\n", FLIGHT_TIME, step);
@@ -481,9 +1083,8 @@ int main(int argc, char *argv[]) {
     snprintf(dat_filename, 1024, "%stmp-evaluation-lcr.dat", TESTNAME);
     lcr_fp = fopen(dat_filename, "w");
 
-    // Data structures initialization (hash tables and migration list)
-    hash_init(table, NSIMULATE * NLP);                  // Global hashtable: all the SEs
-    hash_init(stable, NSIMULATE);                       // Local hastable: local SEs
+    // Data structures initialization (simulation context and migration list)
+    context_init(ctx, 0, rnd_file, NULL);
     list_init(mlist);                                   // Migration list (pending migrations in the local LP)
 
     // Starting the execution timer
@@ -518,7 +1119,7 @@ int main(int argc, char *argv[]) {
 
     // Before starting the real simulation tasks, the model level can initialize some
     //  data structures and set parameters
-    user_bootstrap_handler();
+    user_bootstrap_handler(ctx);
 
     /* Main simulation loop, receives messages and calls the handler associated with them */
     while (!end_reached) {
@@ -527,8 +1128,10 @@ int main(int argc, char *argv[]) {
         max_data = BUFFER_SIZE;
 
         // Looking for a new incoming message
+        phase    = profile_switch(PROFILE_RECEIVE);
         msg_type = GAIA_Receive(&from, &to, &Ts, (void *)data, &max_data);
         msg      = (Msg *)data;
+        profile_switch(phase);
 
         // A message has been received, process it (calling appropriate handler)
         //  message handlers
@@ -537,18 +1140,18 @@ int main(int argc, char *argv[]) {
         //  calling the appropriate handler to insert the SE identifier
         //  in the list of pending migrations
         case NOTIF_MIGR:
-            notify_migration_event_handler(from, to);
+            notify_migration_event_handler(ctx, from, to);
             break;
 
         // A migration has been executed in the simulation but the local
         //  LP is not directly involved in the migration execution
         case NOTIF_MIGR_EXT:
-            notify_ext_migration_event_handler(from, to);
+            notify_ext_migration_event_handler(ctx, from, to);
             break;
 
         // Registration of a new SE that is managed by another LP
         case REGISTER:
-            register_event_handler(from, to);
+            register_event_handler(ctx, from, to);
             break;
 
         // The local LP is the receiver of a migration and therefore a new
@@ -557,7 +1160,7 @@ int main(int argc, char *argv[]) {
         //  and in the following to copy the SE state that is contained
         //  in the migration message
         case EXEC_MIGR:
-            migration_event_handler(from, msg);
+            migration_event_handler(ctx, from, (MigrMsg *)data);
             break;
 
         // End Of Step:
@@ -567,16 +1170,40 @@ int main(int argc, char *argv[]) {
             // Stopping the execution timer
             //  (to record the execution time of each timestep)
             TIMER_NOW(t2);
+            profile_switch(PROFILE_LP);
+
+            // Resuming a run: the timesteps before the checkpoint are skipped,
+            //  then the checkpoint replaces the state built so far (see restore_checkpoint())
+            if ((int)ctx->simclock < env_restore) {
+                profile_switch(PROFILE_ADVANCE);
+                ctx->simclock = GAIA_TimeAdvance();
+                profile_switch(PROFILE_LP);
+                break;
+            }
+            if (env_restore > 0 && (int)ctx->simclock == env_restore) {
+                restore_checkpoint(ctx, &tot);
+            }else if (env_checkpoint > 0 && (int)ctx->simclock > 0 && ctx->simclock < env_end_clock &&
+                      (int)ctx->simclock % (env_checkpoint * env_max_ttl) == 0) {
+                save_checkpoint(ctx, tot);
+            }
+            if (env_sweep > 0 && (int)ctx->simclock == env_sweep_step) {
+                sweep_fork(ctx, tot);
+            }
+
+            // The model events of this timestep are executed first
+            dispatch_model_events(ctx);
 
             /*  Actions to be done at the end of each simulated timestep  */
-            if (simclock < env_end_clock) { // The simulation is not finished
+            if (ctx->simclock < env_end_clock) { // The simulation is not finished
                 // Simulating the interactions among SEs
                 //
                 //  in the last (env_end_clock - FLIGHT_TIME) timesteps
                 //  no msgs will be sent because we wanna check if all
                 //  sent msgs are correctly received
-                if (simclock < (env_end_clock - FLIGHT_TIME)) {
-                    Generate_Computation_and_Interactions(NSIMULATE * NLP);
+                if (ctx->simclock < (env_end_clock - FLIGHT_TIME)) {
+                    profile_switch(PROFILE_COMPUTATION);
+                    Generate_Computation_and_Interactions(ctx, NSIMULATE * NLP);
+                    profile_switch(PROFILE_LP);
                 }
 
                 // The pending migration of "flagged" SEs has to be executed,
@@ -604,27 +1231,37 @@ int main(int argc, char *argv[]) {
                     // Total number of interactions (in the timestep)
                     #ifdef DEBUG
                     float t = loc + rem;
-                    fprintf(stdout, "- [%11.2f]\t[%6.5f]\t%4.0f\t%2.2f\t%2.2f\t%d\n", TIMER_DIFF(t2, t1), simclock, (float)stable->count, (float)loc / (float)t * 100.0, (float)rem / (float)t * 100.0, migr);
-                    if (simclock >= 7) { fprintf(lcr_fp, "%f\n", (float)loc / (float)t * 100.0); }
+                    fprintf(stdout, "- [%11.2f]\t[%6.5f]\t%4.0f\t%2.2f\t%2.2f\t%d\n", TIMER_DIFF(t2, t1), ctx->simclock, (float)ctx->stable->count, (float)loc / (float)t * 100.0, (float)rem / (float)t * 100.0, migr);
+                    if (ctx->simclock >= 7) { fprintf(lcr_fp, "%f\n", (float)loc / (float)t * 100.0); }
                     #endif
                 }else {
                     // Reduced output
                     #ifdef DEBUG
-                    fprintf(stdout, "[%11.2fs]   %12.2f [%d]\n", TIMER_DIFF(t2, t1), simclock, stable->count);
+                    fprintf(stdout, "[%11.2fs]   %12.2f [%d]\n", TIMER_DIFF(t2, t1), ctx->simclock, ctx->stable->count);
                     #endif
                 }
 
+                // All the messages of this timestep have been produced, sending the pending frames
+                frame_flush();
+
+                // Where the time of the LP goes, every env_profile timesteps
+                if (env_profile > 0 && (int)ctx->simclock > 0 && (int)ctx->simclock % env_profile == 0) {
+                    profile_report(stdout, ctx->simclock, env_end_clock);
+                }
+
                 // Now it is possible to advance to the next timestep
-                simclock = GAIA_TimeAdvance();
+                profile_switch(PROFILE_ADVANCE);
+                ctx->simclock = GAIA_TimeAdvance();
+                profile_switch(PROFILE_LP);
             }else {
                 /* End of simulation */
                 TIMER_NOW(t2);
 
-                fprintf(stdout, "\n\n");
-                fprintf(stdout, "### Termination condition reached (%d)\n", tot);
-                fprintf(stdout, "### Clock           %12.2f\n", simclock);
-                fprintf(stdout, "Message received %d times in %d simulations sending %ld messages delivered %ld per epoch. Total steps: %lf, average %lf\n",  countDelivers, countEpochs, countMessages, countMessages/countEpochs, countSteps, countSteps/countDelivers);// / countEpochs);
-                fflush(stdout);
+                print_statistics(ctx, stdout, tot);
+
+                // The other configurations of the sweep
+                sweep_wait();
+                profile_summary(stdout);
 
                 end_reached = 1;
             }
@@ -632,11 +1269,14 @@ int main(int argc, char *argv[]) {
 
         // Simulated model events (user level events)
         case UNSET:
-            // First some checks for validation
-            tmp_node = validation_model_events(from, to, msg);
-
-            // The appropriate handler is defined at model level
-            user_model_events_handler(to, from, msg, tmp_node);
+            // The appropriate handler is defined at model level, it is called
+            //  at the end of the timestep (see dispatch_model_events()).
+            //  A frame contains many model events, directed to this LP
+            if (msg->type == 'F') {
+                frame_unpack(ctx, msg, max_data, buffer_model_event);
+            }else {
+                buffer_model_event(ctx, from, to, msg, max_data);
+            }
             break;
 
         default:
@@ -647,11 +1287,15 @@ int main(int argc, char *argv[]) {
     }
 
 
+    // Stopping the worker threads
+    pool_shutdown();
+
     // Finalize the GAIA framework
     GAIA_Finalize();
 
     // Before shutting down, the model layer is able to deallocate some data structures
-    user_shutdown_handler();
+    user_shutdown_handler(ctx);
+    context_free(ctx);
 
     // Closing output file for performance evaluation
     fclose(lcr_fp);
@@ -0,0 +1,358 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	Loading of the network topology. The DOT file (one
+ *                      "A -- B;" edge per line) is converted once in a binary
+ *                      file (header and edges, see topology.h) that is then
+ *                      memory-mapped by all the runs and all the LPs.
+ *                      The binary file is a cache of the DOT file: it is
+ *                      "graph.dot.bin", next to it, and it is rebuilt when
+ *                      the size or the modification time of the DOT changes
+ *              -	The DOT file is mapped and parsed in parallel: each thread
+ *                      scans a chunk of whole lines in its own edge buffer, the
+ *                      buffers are then concatenated (the order of the edges is
+ *                      the one of the file)
+ *
+ ############################################################################################### */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "topology.h"
+
+
+/*! \brief Part of a DOT file parsed by a thread, with its own edges
+ */
+typedef struct topology_chunk {
+    const char *   begin;                   // First line of the chunk
+    const char *   end;                     // After the last line of the chunk
+    topology_edge *edge;                    // Edges found in the chunk
+    uint64_t       edges;
+    uint64_t       capacity;
+    uint32_t       nodes;                   // Largest node ID + 1
+    const char *   error;                   // Malformed line (NULL if none)
+} topology_chunk;
+
+#define TOPOLOGY_MIN_CHUNK    (64 * 1024)   // Smaller files are parsed by a single thread
+
+/*! \brief Reads an unsigned integer, after the leading blanks (NULL if there
+ *         are no digits)
+ */
+static inline const char *topology_scan_id(const char *p, const char *end, uint32_t *id) {
+    uint32_t value = 0;
+    unsigned digit;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    if (p == end || (unsigned)(*p - '0') > 9) {
+        return(NULL);
+    }
+    while (p < end && (digit = (unsigned)(*p - '0')) <= 9) {
+        value = value * 10 + digit;
+        p++;
+    }
+    *id = value;
+    return(p);
+}
+
+/*! \brief Thread body: parses the "A -- B;" lines of a chunk, the others are skipped
+ */
+static void *topology_parse_chunk(void *arg) {
+    topology_chunk *chunk = (topology_chunk *)arg;
+    const char *    p     = chunk->begin;
+    const char *    eol, *dash;
+    uint32_t        source, destination;
+
+    while (p < chunk->end) {
+        if ((eol = memchr(p, '\n', chunk->end - p)) == NULL) {
+            eol = chunk->end;
+        }
+        for (dash = p; dash + 1 < eol && !(dash[0] == '-' && dash[1] == '-'); dash++) {
+        }
+
+        if (dash + 1 < eol) {
+            if (topology_scan_id(p, dash, &source) == NULL || topology_scan_id(dash + 2, eol, &destination) == NULL) {
+                chunk->error = p;
+                return(NULL);
+            }
+            if (chunk->edges == chunk->capacity) {
+                chunk->capacity = chunk->capacity ? chunk->capacity * 2 : 1024;
+                chunk->edge     = (topology_edge *)realloc(chunk->edge, chunk->capacity * sizeof(topology_edge));
+                if (chunk->edge == NULL) {
+                    fprintf(stdout, "FATAL ERROR, topology_parse_chunk: malloc error\n");
+                    exit(-1);
+                }
+            }
+            chunk->edge[chunk->edges].source      = source;
+            chunk->edge[chunk->edges].destination = destination;
+            chunk->edges++;
+            chunk->nodes = (source >= chunk->nodes) ? source + 1 : chunk->nodes;
+            chunk->nodes = (destination >= chunk->nodes) ? destination + 1 : chunk->nodes;
+        }
+        p = eol + 1;
+    }
+    return(NULL);
+}
+
+/*! \brief Parses the edges of a DOT file, the result is a header followed by the
+ *         edges (in the order of the file). The file is mapped and split in
+ *         chunks of whole lines, parsed by "threads" threads
+ */
+static topology_header *topology_parse_dot(const char *dot_name, int threads) {
+    struct stat      dot_status;
+    topology_header *header;
+    topology_chunk * chunk;
+    pthread_t *      thread;
+    const char *     text = NULL;
+    const char *     split, *eol;
+    uint64_t         edges = 0;
+    int              fd, c, chunks;
+
+    if ((fd = open(dot_name, O_RDONLY)) == -1 || fstat(fd, &dot_status) == -1) {
+        fprintf(stdout, "FATAL ERROR, impossible to open the topology file: %s\n", dot_name);
+        fflush(stdout);
+        exit(-1);
+    }
+    if (dot_status.st_size > 0) {
+        text = (const char *)mmap(NULL, dot_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED) {
+            fprintf(stdout, "FATAL ERROR, impossible to map the topology file: %s\n", dot_name);
+            fflush(stdout);
+            exit(-1);
+        }
+        madvise((void *)text, dot_status.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    chunks = (int)(dot_status.st_size / TOPOLOGY_MIN_CHUNK) + 1;
+    chunks = (chunks > threads) ? threads : chunks;
+    chunks = (chunks < 1) ? 1 : chunks;
+    chunk  = (topology_chunk *)calloc(chunks, sizeof(topology_chunk));
+    thread = (pthread_t *)malloc(chunks * sizeof(pthread_t));
+    if (chunk == NULL || thread == NULL) {
+        fprintf(stdout, "FATAL ERROR, topology_parse_dot: malloc error\n");
+        exit(-1);
+    }
+
+    // The chunks end after a newline
+    for (c = 0; c < chunks; c++) {
+        chunk[c].begin = (c == 0) ? text : chunk[c - 1].end;
+        chunk[c].end   = text + dot_status.st_size;
+        split          = text + (dot_status.st_size * (c + 1)) / chunks;
+        split          = (split < chunk[c].begin) ? chunk[c].begin : split;
+        if (c < chunks - 1 && (split = memchr(split, '\n', chunk[c].end - split)) != NULL) {
+            chunk[c].end = split + 1;
+        }
+    }
+
+    for (c = 1; c < chunks; c++) {
+        if (pthread_create(&thread[c], NULL, topology_parse_chunk, &chunk[c]) != 0) {
+            fprintf(stdout, "FATAL ERROR, impossible to start the parser thread %d\n", c);
+            fflush(stdout);
+            exit(-1);
+        }
+    }
+    topology_parse_chunk(&chunk[0]);
+    for (c = 1; c < chunks; c++) {
+        pthread_join(thread[c], NULL);
+    }
+
+    // Merging the edges of the chunks, in order
+    for (c = 0; c < chunks; c++) {
+        if (chunk[c].error != NULL) {
+            // The text is not terminated: the line ends at the newline or at the end of the chunk
+            if ((eol = memchr(chunk[c].error, '\n', chunk[c].end - chunk[c].error)) == NULL) {
+                eol = chunk[c].end;
+            }
+            fprintf(stdout, "FATAL ERROR, malformed edge in the topology file %s: %.*s\n", dot_name,
+                    (int)(eol - chunk[c].error), chunk[c].error);
+            fflush(stdout);
+            exit(-1);
+        }
+        edges += chunk[c].edges;
+    }
+    header = (topology_header *)calloc(1, sizeof(topology_header) + edges * sizeof(topology_edge));
+    if (header == NULL) {
+        fprintf(stdout, "FATAL ERROR, topology_parse_dot: malloc error\n");
+        exit(-1);
+    }
+    for (c = 0; c < chunks; c++) {
+        if (chunk[c].edges > 0) {
+            memcpy((topology_edge *)(header + 1) + header->edges, chunk[c].edge, chunk[c].edges * sizeof(topology_edge));
+        }
+        header->edges += chunk[c].edges;
+        header->nodes  = (chunk[c].nodes > header->nodes) ? chunk[c].nodes : header->nodes;
+        free(chunk[c].edge);
+    }
+    free(chunk);
+    free(thread);
+    if (text != NULL) {
+        munmap((void *)text, dot_status.st_size);
+    }
+
+    memcpy(header->magic, TOPOLOGY_MAGIC, sizeof(header->magic));
+    header->version = TOPOLOGY_VERSION;
+
+    return(header);
+}
+
+/*! \brief Maps a binary topology, it fails (-1) if it is not the cache of a
+ *         DOT file with the given status
+ */
+static int topology_map(const char *bin_name, struct stat *dot_status, topology_t *topo) {
+    struct stat      bin_status;
+    topology_header *header;
+    int              fd;
+
+    if ((fd = open(bin_name, O_RDONLY)) == -1) {
+        return(-1);
+    }
+    if (fstat(fd, &bin_status) == -1 || bin_status.st_size < (off_t)sizeof(topology_header)) {
+        close(fd);
+        return(-1);
+    }
+    header = (topology_header *)mmap(NULL, bin_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED) {
+        return(-1);
+    }
+
+    if (memcmp(header->magic, TOPOLOGY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TOPOLOGY_VERSION ||
+        header->dot_size != (uint64_t)dot_status->st_size ||
+        header->dot_mtime != (int64_t)dot_status->st_mtim.tv_sec ||
+        header->dot_mtime_nsec != (int64_t)dot_status->st_mtim.tv_nsec ||
+        (uint64_t)bin_status.st_size != sizeof(topology_header) + header->edges * sizeof(topology_edge)) {
+        munmap(header, bin_status.st_size);
+        return(-1);
+    }
+
+    topo->header = header;
+    topo->edge   = (topology_edge *)(header + 1);
+    topo->length = bin_status.st_size;
+    return(0);
+}
+
+/*! \brief Writes the binary topology of a DOT file, 0 on success. The file is
+ *         renamed at the end: concurrent writers (e.g. the LPs or the replicas
+ *         of a process) are harmless
+ */
+static int topology_write(const char *bin_name, topology_header *header, const topology_edge *edge) {
+    char   tmp_name[1024];
+    FILE * bin_file;
+    size_t length = header->edges * sizeof(topology_edge);
+
+    snprintf(tmp_name, sizeof(tmp_name), "%s.%d.%lx.tmp", bin_name, (int)getpid(), (unsigned long)pthread_self());
+    if ((bin_file = fopen(tmp_name, "wb")) == NULL) {
+        return(-1);
+    }
+    if (fwrite(header, 1, sizeof(topology_header), bin_file) != sizeof(topology_header) ||
+        (length > 0 && fwrite(edge, 1, length, bin_file) != length)) {
+        fclose(bin_file);
+        unlink(tmp_name);
+        return(-1);
+    }
+    if (fclose(bin_file) != 0 || rename(tmp_name, bin_name) != 0) {
+        unlink(tmp_name);
+        return(-1);
+    }
+    return(0);
+}
+
+/*! \brief Converts a DOT file in its binary topology (bin_name), 0 on success.
+ *         The DOT file is parsed by "threads" threads
+ */
+int topology_convert(const char *dot_name, const char *bin_name, int threads) {
+    struct stat      dot_status;
+    topology_header *header;
+    int              ret;
+
+    header = topology_parse_dot(dot_name, threads);
+    if (stat(dot_name, &dot_status) == -1) {
+        free(header);
+        return(-1);
+    }
+    header->dot_size       = dot_status.st_size;
+    header->dot_mtime      = dot_status.st_mtim.tv_sec;
+    header->dot_mtime_nsec = dot_status.st_mtim.tv_nsec;
+
+    ret = topology_write(bin_name, header, (topology_edge *)(header + 1));
+    free(header);
+
+    return(ret);
+}
+
+/*! \brief Writes the binary topology of a DOT file from its edges (e.g. built
+ *         by graphgen while writing the DOT file), 0 on success. The DOT file
+ *         must be complete: its size and modification time are stored
+ */
+int topology_save(const char *dot_name, const topology_edge *edge, uint64_t edges, uint32_t nodes) {
+    struct stat     dot_status;
+    topology_header header;
+    char            bin_name[1024];
+
+    if (stat(dot_name, &dot_status) == -1) {
+        return(-1);
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TOPOLOGY_MAGIC, sizeof(header.magic));
+    header.version        = TOPOLOGY_VERSION;
+    header.nodes          = nodes;
+    header.edges          = edges;
+    header.dot_size       = dot_status.st_size;
+    header.dot_mtime      = dot_status.st_mtim.tv_sec;
+    header.dot_mtime_nsec = dot_status.st_mtim.tv_nsec;
+
+    snprintf(bin_name, sizeof(bin_name), "%s%s", dot_name, TOPOLOGY_SUFFIX);
+    return(topology_write(bin_name, &header, edge));
+}
+
+/*! \brief Loads the topology of a DOT file: its binary cache is mapped, it is
+ *         built first if missing or stale. If the cache can not be written the
+ *         DOT file is parsed in memory
+ */
+void topology_load(const char *dot_name, topology_t *topo, int threads) {
+    struct stat dot_status;
+    char        bin_name[1024];
+
+    if (stat(dot_name, &dot_status) == -1) {
+        fprintf(stdout, "FATAL ERROR, impossible to open the topology file: %s\n", dot_name);
+        fflush(stdout);
+        exit(-1);
+    }
+    snprintf(bin_name, sizeof(bin_name), "%s%s", dot_name, TOPOLOGY_SUFFIX);
+
+    if (topology_map(bin_name, &dot_status, topo) == 0) {
+        return;
+    }
+    if (topology_convert(dot_name, bin_name, threads) == 0 && topology_map(bin_name, &dot_status, topo) == 0) {
+        return;
+    }
+
+    topo->header = topology_parse_dot(dot_name, threads);
+    topo->edge   = (topology_edge *)(topo->header + 1);
+    topo->length = 0;
+}
+
+/*! \brief Releases a loaded topology
+ */
+void topology_release(topology_t *topo) {
+    if (topo->length > 0) {
+        munmap(topo->header, topo->length);
+    }else {
+        free(topo->header);
+    }
+    topo->header = NULL;
+    topo->edge   = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
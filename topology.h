@@ -0,0 +1,59 @@
+/*	##############################################################################################
+ *      Advanced RTI System, ARTÌS			http://pads.cs.unibo.it
+ *      Large Unstructured NEtwork Simulator (LUNES)
+ *
+ *      Description:
+ *              -	See "topology.c" description
+ *              -	Binary topology format
+ *              -	Function prototypes
+ *
+ ############################################################################################### */
+
+#ifndef __TOPOLOGY_H
+#define __TOPOLOGY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+#define TOPOLOGY_MAGIC      "LUNESTOP"
+#define TOPOLOGY_VERSION    2
+#define TOPOLOGY_SUFFIX     ".bin"          // The cache of "graph.dot" is "graph.dot.bin"
+
+/*! \brief Header of the binary topology file, the edges follow (in the order
+ *         of the DOT file)
+ */
+typedef struct topology_header {
+    char     magic[8];                      // TOPOLOGY_MAGIC
+    uint32_t version;                       // TOPOLOGY_VERSION
+    uint32_t nodes;                         // Largest node ID + 1
+    uint64_t edges;                         // Number of edges
+    uint64_t dot_size;                      // Size of the DOT file it was built from
+    int64_t  dot_mtime;                     // Modification time of the DOT file it was built from (seconds)
+    int64_t  dot_mtime_nsec;                // and its nanoseconds, a DOT file rewritten within a second is seen
+} topology_header;
+
+typedef struct topology_edge {
+    uint32_t source;
+    uint32_t destination;
+} topology_edge;
+
+/*! \brief A loaded topology, the edges are mapped from the binary file (or
+ *         allocated when the file can not be written)
+ */
+typedef struct topology_t {
+    topology_header *header;
+    topology_edge *  edge;
+    size_t           length;                // Size of the mapping (0 if allocated)
+} topology_t;
+
+
+/* ************************************************************************ */
+/*                      Prototypes		                                    */
+/* ************************************************************************ */
+int  topology_convert(const char *, const char *, int);
+int  topology_save(const char *, const topology_edge *, uint64_t, uint32_t);
+void topology_load(const char *, topology_t *, int);
+void topology_release(topology_t *);
+
+#endif /* __TOPOLOGY_H */
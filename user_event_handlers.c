@@ -35,6 +35,10 @@
 #include <rnd.h>
 #include "utils.h"
 #include "msg_definition.h"
+#include "rng.h"
+#include "pool.h"
+#include "profile.h"
+#include "context.h"
 #include "lunes.h"
 #include "lunes_constants.h"
 #include "user_event_handlers.h"
@@ -44,9 +48,6 @@
 /*          E X T E R N A L     V A R I A B L E S                           */
 /* ************************************************************************ */
 
-extern hash_t hash_table, *table;                   /* Global hash table of simulated entities */
-extern hash_t sim_table, *stable;                   /* Hash table of locally simulated entities */
-extern double simclock;                             /* Time management, simulated time */
 extern TSeed  Seed, *S;                             /* Seed used for the random generator */
 extern FILE * fp_print_trace;                       /* File descriptor for simulation trace file */
 extern char * TESTNAME;                             /* Test name */
@@ -68,8 +69,17 @@ extern float          env_fixed_prob_threshold;     /* Dissemination: fixed prob
 extern int 			  env_perc_active_nodes_;		/* Initial percentage of active node*/
 extern unsigned int   env_probability_function;     /* Probability function for Degree Dependent Gossip */
 extern double         env_function_coefficient;     /* Coefficient of probability function */
-extern int            applicant;                    /* ID of the applicant node*/
-extern int            holder;                       /* ID of the holder node*/
+extern int            env_lookups;                  /* Concurrent lookups in each epoch */
+extern int            env_threads;                  /* Worker threads of the LP */
+extern int            env_bulk_links;               /* Links of the topology built locally, without link messages */
+extern int            env_checkpoint;               /* Epochs between two checkpoints */
+extern int            env_restore;                  /* Timestep of the checkpoint to resume from */
+extern int            env_sweep;                    /* Configurations of the sweep */
+extern int            env_sweep_step;               /* Timestep of the sweep */
+extern int            env_replicas;                 /* Replicas of the run in this process */
+extern char *         env_replica_graphs;           /* Topology of each replica */
+extern int            env_metrics;                  /* Per-epoch metrics stream */
+extern int            env_profile;                  /* Timesteps between two reports of the profiler */
 
 
 
@@ -94,28 +104,6 @@ void UNUSED hash_table_print(GHashTable *ht) {
     }
 }
 
-/*! \brief Returns a random key from a hash table
- */
-gpointer  hash_table_random_key(GHashTable *ht) {
-    // Iterator to scan the (whole) state hashtable of entities
-    GHashTableIter iter;
-    gpointer       key, value;
-    guint          size;
-    unsigned int   position;
-
-    size     = g_hash_table_size(ht);
-    position = RND_Integer(S, (double)1, (double)size);
-
-    g_hash_table_iter_init(&iter, ht);
-
-    while (position) {
-        g_hash_table_iter_next(&iter, &key, &value);
-        position--;
-    }
-    return(key);
-}
-
-
 /*! \brief Utility to check environment variables, if the variable is not defined then the run is aborted
  */
 char *check_and_getenv(char *variable) {
@@ -133,64 +121,47 @@ char *check_and_getenv(char *variable) {
 
 /* *********** E N T I T Y    S T A T E    M A N A G E M E N T **************/
 
-/*! \brief Adds a new entry in the hash table that implements the SE's local state
+/*! \brief Adds a new entry in the set of neighbors that implements the SE's local state
  *         Note: it is used both from the register and the migration handles
  */
-int add_entity_state_entry(unsigned int key, value_element *val, int id, hash_node_t *node) {
-    struct  state_element *state_e;
-
-    // First of all, it is necessary to check if the used key is already in the hash table
-    if (g_hash_table_lookup(node->data->state, &key) != NULL) { return(-1); }
+int add_entity_state_entry(context_t *ctx, unsigned int key, value_element *val, int id, hash_node_t *node) {
+    // First of all, it is necessary to check if the used key is already in the set
+    if (adj_row_find(&node->data->neighbors, key) != -1) { return(-1); }
 
     // The number of state records is limited by the MAX_MIGRATION_DYNAMIC_RECORDS constant,
     //	that is the max number of records that can be inserted in a migration message
-    if (g_hash_table_size(node->data->state) > MAX_MIGRATION_DYNAMIC_RECORDS) {
+    if (node->data->neighbors.count > MAX_MIGRATION_DYNAMIC_RECORDS) {
         // No more entries can be added, the resulting state would be impossible to migrate
-        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] impossible to add new elements to the state hash table of this node, see constant MAX_MIGRATION_DYNAMIC_RECORDS in file: sim-parameters.h\n", simclock, id);
+        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] impossible to add new elements to the state hash table of this node, see constant MAX_MIGRATION_DYNAMIC_RECORDS in file: sim-parameters.h\n", ctx->simclock, id);
         fflush(stdout);
         exit(-1);
     }
 
-    // Dynamic allocation of memory and initialization of values
-    // Note: this memory will be automatically freed in case of SE migration
-    state_e = g_malloc(sizeof(struct state_element));
-    if (state_e) {
-        state_e->key      = key;
-        state_e->elements = *val;
-
-        g_hash_table_insert(node->data->state, &(state_e->key), &(state_e->elements));
+    // Insertion in the adjacency row (swap-remove set, see utils.c)
+    adj_row_insert(ctx->csr, &node->data->neighbors, key, val);
 
-        #ifdef DEBUG
-        fprintf(stdout, "%12.2f node: [%5d] local state key: %d, local hash_size: %d\n", simclock, id, state_e->key, g_hash_table_size(node->data->state));
-        fflush(stdout);
-        #endif
-        return(1);
-    }else {
-        // Unable to allocate memory for state elements
-        fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d], memory allocation, impossible to add new elements to the state hash table of this node\n", simclock, id);
-        fflush(stdout);
-        exit(-1);
-    }
+    #ifdef DEBUG
+    fprintf(stdout, "%12.2f node: [%5d] local state key: %d, local hash_size: %d\n", ctx->simclock, id, key, node->data->neighbors.count);
+    fflush(stdout);
+    #endif
+    return(1);
 }
 
-/*! \brief Deletes an entry in the hash table that implements the SE's local state
- *         Note: the freeing of the associated memory is automatic
+/*! \brief Deletes an entry in the set of neighbors that implements the SE's local state
  */
-int delete_entity_state_entry(unsigned int key, hash_node_t *node) {
-    if (g_hash_table_remove(node->data->state, &key) == TRUE) { return(0); }else {
-        return(-1);
-    }
+int delete_entity_state_entry(context_t *ctx, unsigned int key, hash_node_t *node) {
+    return(adj_row_delete(ctx->csr, &node->data->neighbors, key));
 }
 
 /*! \brief Modifies the value of an entry in the SE's local state
  */
-int modify_entity_state_entry(unsigned int key, unsigned int new_value, hash_node_t *node) {
-    unsigned int *value;
+int modify_entity_state_entry(context_t *ctx, unsigned int key, unsigned int new_value, hash_node_t *node) {
+    int position;
 
-    value = g_hash_table_lookup(node->data->state, &key);
+    position = adj_row_find(&node->data->neighbors, key);
 
-    if (value) {
-        *(value) = new_value;
+    if (position != -1) {
+        node->data->neighbors.record[position].elements.value = new_value;
         return(0);
     }else {
         return(-1);
@@ -198,27 +169,32 @@ int modify_entity_state_entry(unsigned int key, unsigned int new_value, hash_nod
 }
 
 
-void execute_request(double ts, hash_node_t *src, hash_node_t *dest, unsigned short ttl, int req_id, float timestamp, unsigned int creator) {
+void execute_request(context_t *ctx, double ts, hash_node_t *src, hash_node_t *dest, unsigned short ttl, int req_id, float timestamp, unsigned int creator) {
     RequestMsg     msg;
     unsigned int message_size;
 
+    // The unused fields are cleared too: the messages are compared byte by byte (see t_graph.c)
+    memset(&msg, 0, sizeof(struct _request_static_part));
+
     // Defining the message type
-    msg.request_static.type = 'R';
+    msg.request_static.type    = 'R';
+    msg.request_static.version = MSG_VERSION;
 
     msg.request_static.timestamp  = timestamp;
     msg.request_static.ttl        = ttl;
+    msg.request_static.id         = req_id;
     msg.request_static.creator    = creator;
-    message_size = sizeof(struct _request_static_part);
+    message_size = REQUEST_MSG_SIZE;
 
     // Buffer check
     if (message_size > BUFFER_SIZE) {
-        fprintf(stdout, "%12.2f FATAL ERROR, the outgoing BUFFER_SIZE is not sufficient!\n", simclock);
+        fprintf(stdout, "%12.2f FATAL ERROR, the outgoing BUFFER_SIZE is not sufficient!\n", ctx->simclock);
         fflush(stdout);
         exit(-1);
     }
 
     if (ttl > 0){
-        GAIA_Send(src->data->key, dest->data->key, ts, (void *)&msg, message_size);
+        pool_send(ctx, src->data->key, dest->data->key, ts, (void *)&msg, message_size);
     }
     // Real send
 
@@ -229,46 +205,52 @@ void execute_request(double ts, hash_node_t *src, hash_node_t *dest, unsigned sh
  *         In LUNES it is used to build up the graph structure that has been read
  *         from the input graph definition file (in dot format).
  */
-void execute_link(double ts, hash_node_t *src, hash_node_t *dest) {
+void execute_link(context_t *ctx, double ts, hash_node_t *src, hash_node_t *dest) {
     LinkMsg      msg;
     unsigned int message_size;
 
+    memset(&msg, 0, sizeof(struct _link_static_part));
+
     // Defining the message type
-    msg.link_static.type = 'L';
+    msg.link_static.type    = 'L';
+    msg.link_static.version = MSG_VERSION;
 
     // To reduce the network overhead, only the used part of the message is really sent
-    message_size = sizeof(struct _link_static_part);
+    message_size = LINK_MSG_SIZE;
 
     // Buffer check
     if (message_size > BUFFER_SIZE) {
-        fprintf(stdout, "%12.2f FATAL ERROR, the outgoing BUFFER_SIZE is not sufficient!\n", simclock);
+        fprintf(stdout, "%12.2f FATAL ERROR, the outgoing BUFFER_SIZE is not sufficient!\n", ctx->simclock);
         fflush(stdout);
         exit(-1);
     }
 
-    // Real send
-    GAIA_Send(src->data->key, dest->data->key, ts, (void *)&msg, message_size);
+    // Real send (buffered inside the parallel sections)
+    pool_send(ctx, src->data->key, dest->data->key, ts, (void *)&msg, message_size);
 }
 
-void execute_unlink(double ts, hash_node_t *src, hash_node_t *dest) {
+void execute_unlink(context_t *ctx, double ts, hash_node_t *src, hash_node_t *dest) {
     UnlinkMsg      msg;
     unsigned int message_size;
 
+    memset(&msg, 0, sizeof(struct _unlink_static_part));
+
     // Defining the message type
-    msg.unlink_static.type = 'U';
+    msg.unlink_static.type    = 'U';
+    msg.unlink_static.version = MSG_VERSION;
 
     // To reduce the network overhead, only the used part of the message is really sent
-    message_size = sizeof(struct _unlink_static_part);
+    message_size = UNLINK_MSG_SIZE;
 
     // Buffer check
     if (message_size > BUFFER_SIZE) {
-        fprintf(stdout, "%12.2f FATAL ERROR, the outgoing BUFFER_SIZE is not sufficient!\n", simclock);
+        fprintf(stdout, "%12.2f FATAL ERROR, the outgoing BUFFER_SIZE is not sufficient!\n", ctx->simclock);
         fflush(stdout);
         exit(-1);
     }
 
-    // Real send
-    GAIA_Send(src->data->key, dest->data->key, ts, (void *)&msg, message_size);
+    // Real send (buffered inside the parallel sections)
+    pool_send(ctx, src->data->key, dest->data->key, ts, (void *)&msg, message_size);
 }
 
 /* ************************************************************************ */
@@ -283,51 +265,54 @@ void execute_unlink(double ts, hash_node_t *src, hash_node_t *dest) {
 /****************************************************************************
  *! \brief BLOCK: Upon arrival of an mined block
  */
-void user_request_event_handler(hash_node_t *node, int forwarder, Msg *msg) {
+void user_request_event_handler(context_t *ctx, hash_node_t *node, int forwarder, Msg *msg) {
     
     #ifdef TRACE_DISSEMINATION
     float difference;
-    difference = simclock - msg->block.block_static.timestamp;
+    difference = ctx->simclock - msg->block.block_static.timestamp;
     fprintf(fp_print_trace, "R %010u %010u %03u\n", node->data->key, msg->block.block_static.transid, (int)difference);
     #endif
 
     // Calling the appropriate LUNES user level handler
-    lunes_user_request_event_handler(node, forwarder, msg);
+    lunes_user_request_event_handler(ctx, node, forwarder, msg);
 }
 
 
 /****************************************************************************
  *! \brief LINK: upon arrival of a link request some tasks have to be executed
  */
-void user_link_event_handler(hash_node_t *node, int id) {
+void user_link_event_handler(context_t *ctx, hash_node_t *node, int id) {
     value_element val;
 
+    // The handle of the new neighbor is resolved once, here
     val.value = id;
+    val.node  = hash_lookup(ctx->table, id);
 
     // Adding a new entry in the local state of the registering node
     //	first entry	= key
     //	second entry	= value
     //	note: no duplicates are allowed
-    if (add_entity_state_entry(id, &val, node->data->key, node) == -1) {
+    if (add_entity_state_entry(ctx, id, &val, node->data->key, node) == -1) {
         // Insertion aborted, the key is already in the hash table
-        /*fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] key %d (value %d) is a duplicate and can not be inserted in the hash table of local state\n", simclock, node->data->key, id, id);
+        /*fprintf(stdout, "%12.2f node: FATAL ERROR, [%5d] key %d (value %d) is a duplicate and can not be inserted in the hash table of local state\n", ctx->simclock, node->data->key, id, id);
         fflush(stdout);
         exit(-1);*/
     } else {
-   		node->data->num_neighbors++;
+   		SE_NUM_NEIGHBORS(ctx, node)++;
    	}
 
     #ifdef AG_DEBUG
-    fprintf(stdout, "%12.2f node: [%5d] received a link request from agent [%5d], total received requests: %d\n", simclock, node->data->key, id, g_hash_table_size(node->data->state));
+    fprintf(stdout, "%12.2f node: [%5d] received a link request from agent [%5d], total received requests: %d\n", ctx->simclock, node->data->key, id, node->data->neighbors.count);
     #endif
 }
 
 
-void user_unlink_event_handler(hash_node_t *node, int id) {
-    delete_entity_state_entry(id, node);
-    if (node->data->num_neighbors > 0){
-    	node->data->num_neighbors --;
+void user_unlink_event_handler(context_t *ctx, hash_node_t *node, int id) {
+    delete_entity_state_entry(ctx, id, node);
+    if (SE_NUM_NEIGHBORS(ctx, node) > 0){
+    	SE_NUM_NEIGHBORS(ctx, node) --;
 	}
+    lunes_watch_isolated(ctx, node);
 }
 
 
@@ -335,9 +320,9 @@ void user_unlink_event_handler(hash_node_t *node, int id) {
  *! \brief REGISTER: a new SE (in this LP) has been created, now it is possibile to
  *         initialize its data structures (es. local state)
  */
-void user_register_event_handler(hash_node_t *node, int id) {
+void user_register_event_handler(context_t *ctx, hash_node_t *node, int id) {
     // Initializing the local data structures of the node
-    node->data->state = g_hash_table_new_full(g_int_hash, g_int_equal, g_free, NULL);
+    adj_row_init(&node->data->neighbors);
     // Calling the appropriate LUNES user level handler
 }
 
@@ -346,7 +331,7 @@ void user_register_event_handler(hash_node_t *node, int id) {
  *      This notification is reported to the user level but usually nothing
  *      has to be done
  */
-void user_notify_migration_event_handler() {
+void user_notify_migration_event_handler(context_t *ctx) {
     // Nothing to do
 }
 
@@ -355,7 +340,7 @@ void user_notify_migration_event_handler() {
  *      to be migrated, this LP is notified of this update but the user level
  *      usually does not care of it
  */
-void  user_notify_ext_migration_event_handler() {
+void  user_notify_ext_migration_event_handler(context_t *ctx) {
     // Nothing to do
 }
 
@@ -366,14 +351,39 @@ void  user_notify_ext_migration_event_handler() {
  *         perform some user level tasks such as taking care of de-serializing the
  *         SE's local state
  */
-void user_migration_event_handler(hash_node_t *node, int id, Msg *msg) {
+void user_migration_event_handler(context_t *ctx, hash_node_t *node, int id, MigrMsg *msg) {
+    unsigned int   i;
+    value_element *val;
+
     // Initializing the local data structures of the node
-    node->data->state = g_hash_table_new_full(g_int_hash, g_int_equal, g_free, NULL);
+    adj_row_init(&node->data->neighbors);
 
     // The migration message contains the state of the migrating SE,
     //	after allocating space to locally manage the node, I've
     //	to update now the state of the SE using the state
     //	information contained in the migration message
+    for (i = 0; i < msg->migration_static.dyn_records; i++) {
+        // The handles of the neighbors are meaningful only in the sender LP
+        val       = &msg->migration_dynamic.records[i].elements;
+        val->node = hash_lookup(ctx->table, msg->migration_dynamic.records[i].key);
+
+        add_entity_state_entry(ctx, msg->migration_dynamic.records[i].key, val, id, node);
+    }
+
+    // The churn of the node goes on in this LP
+    lunes_user_migration_event_handler(ctx, node);
+}
+
+/*! \brief Worker task: initial activity of the local SEs in [first, last)
+ */
+static void control_task(int first, int last, void *arg) {
+    context_t *ctx = (context_t *)arg;
+    int        h;
+
+    for (h = first; h < last; h++) {
+        // Calling the appropriate LUNES user level handler
+        lunes_user_control_handler(ctx, &ctx->stable->node[h]);
+    }
 }
 
 /*****************************************************************************
@@ -381,43 +391,80 @@ void user_migration_event_handler(hash_node_t *node, int id, Msg *msg) {
  *      of model level interactions, for performance reasons the handler is called once
  *      for all the SE that allocated in the LP
  */
-void user_control_handler() {
-    int          h;
-    hash_node_t *node;
+void user_control_handler(context_t *ctx) {
     hash_node_t *tempNode;
+    int          phase;
 
-    if (simclock == ((float)BUILDING_STEP) + 1) {         //just once: build network topology ignoring non-active nodes       
+    if (ctx->simclock == ((float)BUILDING_STEP) + 1) {         //just once: build network topology ignoring non-active nodes       
         // Loading the graph topology that was previously generated
-        lunes_load_graph_topology();
+        phase = profile_switch(PROFILE_TOPOLOGY);
+        lunes_load_graph_topology(ctx);
+        profile_switch(phase);
+    }
+
+    // At the beginning of each epoch the links changed by the churn are folded back in the adjacency snapshot
+    if ((int)ctx->simclock > BUILDING_STEP && (int)ctx->simclock % env_max_ttl == 0) {
+        phase = profile_switch(PROFILE_EPOCH);
+        csr_fold(ctx->csr, ctx->stable);
+        profile_switch(phase);
     }
 
-    if ((int)simclock > EXECUTION_STEP && (int)simclock % env_max_ttl == 0 && simclock < env_end_clock - env_max_ttl){   //start of an epoch: chosing each time a new aplicant and holder
-        //chosing applicant node
-        int rnd; 
-        do {
-        	rnd = RND_Interval(S, 0, NLP * NSIMULATE);
-            tempNode = hash_lookup(table, rnd);
-        } while ( tempNode->data->status == 0);
-        applicant = tempNode->data->key;
-        //choosing holder node
-        do {
-        	rnd = RND_Interval(S, 0, NLP * NSIMULATE);
-            tempNode = hash_lookup(table, rnd);
-        } while ( tempNode->data->status == 0 || tempNode->data->key == applicant);
-    	holder = tempNode->data->key;
+    if ((int)ctx->simclock > EXECUTION_STEP && (int)ctx->simclock % env_max_ttl == 0 && ctx->simclock < env_end_clock - env_max_ttl){   //start of an epoch: chosing each time a new aplicant and holder
+        int rnd, k;
+
+        // One pair for each concurrent lookup, all the LPs draw the same pairs
+        for (k = 0; k < env_lookups; k++) {
+            //chosing applicant node
+            do {
+            	rnd = rng_integer(&ctx->rng, RNG_GLOBAL, (int)ctx->simclock, RNG_SELECT, 0, NLP * NSIMULATE - 1);
+                tempNode = hash_lookup(ctx->table, rnd);
+            } while ( SE_STATUS(ctx, tempNode) == 0);
+            ctx->applicant[k] = tempNode->data->key;
+            //choosing holder node
+            do {
+            	rnd = rng_integer(&ctx->rng, RNG_GLOBAL, (int)ctx->simclock, RNG_SELECT, 0, NLP * NSIMULATE - 1);
+                tempNode = hash_lookup(ctx->table, rnd);
+            } while ( SE_STATUS(ctx, tempNode) == 0 || tempNode->data->key == ctx->applicant[k]);
+        	ctx->holder[k] = tempNode->data->key;
+        }
     }
 
     // Only if in the aggregation phase is finished &&
     // if it is possible to send messages up to the last simulated timestep then the statistics will be
     // affected by some messages that have been sent but with no time to be received
-    if ((simclock >= (float)BUILDING_STEP) && (simclock < (env_end_clock - MAX_TTL))) {
-        // For each local SE
-        for (h = 0; h < stable->size; h++) {
-            for (node = stable->bucket[h]; node; node = node->next) {
-                // Calling the appropriate LUNES user level handler
-                lunes_user_control_handler(node);
-            } 
+    if ((ctx->simclock >= (float)BUILDING_STEP) && (ctx->simclock < (env_end_clock - MAX_TTL))) {
+        // At the beginning of each epoch: linear scans of the hot fields of all the local SEs
+        if ((int)ctx->simclock % env_max_ttl == 0 && (int)ctx->simclock >= env_max_ttl) {
+            phase = profile_switch(PROFILE_EPOCH);
+            lunes_user_epoch_handler(ctx);
+            profile_switch(phase);
+        }
+
+        // Just once: initial activity of each local SE (shared among the workers)
+        if (ctx->simclock == BUILDING_STEP) {
+            pool_run(control_task, ctx->stable->count, ctx);
         }
+
+        // Only the SEs with some activity in this timestep
+        phase = profile_switch(PROFILE_CHURN);
+        lunes_user_churn_handler(ctx);
+        profile_switch(phase);
+    }
+}
+
+/*****************************************************************************
+ *! \brief USER MODEL: phase of a model level interaction. The events of a
+ *         timestep are executed a phase at a time: first the changes of the
+ *         topology, then the dissemination (that reads the degree of the neighbors)
+ */
+int user_model_events_phase(Msg *msg) {
+    switch (msg->type) {
+    case 'L':
+    case 'U':
+        return(0);
+
+    default:
+        return(1);
     }
 }
 
@@ -426,24 +473,31 @@ void user_control_handler() {
  *         validation this generic handler is called. The specific user level
  *         handler will complete its processing
  */
-void user_model_events_handler(int to, int from, Msg *msg, hash_node_t *node) {
+void user_model_events_handler(context_t *ctx, int to, int from, Msg *msg, hash_node_t *node) {
 
     // A model event has been received, now calling appropriate user level handler
 
+    // The version follows the type in all the model messages
+    if (msg->request.request_static.version != MSG_VERSION) {
+        fprintf(stdout, "FATAL ERROR, received a model event (type: %d) with encoding version %d, expected %d\n", msg->type, msg->request.request_static.version, MSG_VERSION);
+        fflush(stdout);
+        exit(-1);
+    }
+
     // If the node should perform a DOS attack: not a miner and is an attacker
     switch (msg->type) {
     // A transaction message
     case 'R':
-        user_request_event_handler(node, from, msg);
+        user_request_event_handler(ctx, node, from, msg);
         break;
 
     // A link message
     case 'L':
-        user_link_event_handler(node, from);
+        user_link_event_handler(ctx, node, from);
         break;
      // A link message
     case 'U':
-        user_unlink_event_handler(node, from);
+        user_unlink_event_handler(ctx, node, from);
         break;
 
     default:
@@ -453,57 +507,10 @@ void user_model_events_handler(int to, int from, Msg *msg, hash_node_t *node) {
     }
 }
 
-void user_environment_handler() {
-    // ######################## RUNTIME CONFIGURATION SECTION ####################################
-    //	Runtime configuration:	migration type configuration
-    env_migration = atoi(check_and_getenv("MIGRATION"));
-    fprintf(stdout, "LUNES____[%10d]: MIGRATION, migration variable set to %d\n", local_pid, env_migration);
-    if ((env_migration > 0) && (env_migration < 4)) {
-        fprintf(stdout, "LUNES____[%10d]: MIGRATION is ON, migration type is set to %d\n", local_pid, env_migration);
-        GAIA_SetMigration(env_migration);
-    }else {
-        fprintf(stdout, "LUNES____[%10d]: MIGRATION is OFF\n", local_pid);
-        GAIA_SetMigration(MIGR_OFF);
-    }
-
-    //	Runtime configuration:	migration factor (GAIA)
-    env_migration_factor = atof(check_and_getenv("MFACTOR"));
-    fprintf(stdout, "LUNES____[%10d]: MFACTOR, migration factor: %f\n", local_pid, env_migration_factor);
-    GAIA_SetMF(env_migration_factor);
-
-    //	Runtime configuration:	turning on/off the load balancing (GAIA)
-    env_load = atoi(check_and_getenv("LOAD"));
-    fprintf(stdout, "LUNES____[%10d]: LOAD, load balancing: %d\n", local_pid, env_load);
-    if (env_load == 1) {
-        fprintf(stdout, "LUNES____[%10d]: LOAD, load balancing is ON\n", local_pid);
-        GAIA_SetLoadBalancing(LOAD_ON);
-    }else {
-        fprintf(stdout, "LUNES____[%10d]: LOAD, load balancing is OFF\n", local_pid);
-        GAIA_SetLoadBalancing(LOAD_OFF);
-    }
-
-    //	Runtime configuration:	number of steps in the simulation run
-    env_end_clock = atof(check_and_getenv("END_CLOCK"));
-    fprintf(stdout, "LUNES____[%10d]: END_CLOCK, number of steps in the simulation run -> %f\n", local_pid, env_end_clock);
-    if (env_end_clock == 0) {
-        fprintf(stdout, "LUNES____[%10d]:  END_CLOCK is 0, no timesteps are defined for this run!!!\n", local_pid);
-    }
-
-    env_perc_active_nodes_ = atof(check_and_getenv("ACTIVE_PERC"));
-    fprintf(stdout, "LUNES____[%10d]: ACTIVE_PERC, initial percentage of active nodes -> %d\n", local_pid, env_perc_active_nodes_);
-    if (env_perc_active_nodes_ <= 0) {
-        fprintf(stdout, "LUNES____[%10d]: ACTIVE_PERC is <= 0, error \n", local_pid);
-    }
-
-    //	Runtime configuration:	time-to-live for new messages in the network
-    env_max_ttl = atoi(check_and_getenv("MAX_TTL"));
-    fprintf(stdout, "LUNES____[%10d]: MAX_TTL, maximum time-to-live for messages in the network -> %d\n", local_pid, env_max_ttl);
-
-    if (env_max_ttl == 0) {
-        fprintf(stdout, "LUNES____[%10d]: MAX_TTL is 0, no TTL is defined for this run!\n", local_pid);
-    }
-
-
+/*! \brief Runtime configuration of the dissemination mode (gossip protocol) and
+ *         of its parameters, called again for each configuration of a sweep
+ */
+static void dissemination_environment() {
     //	Runtime configuration:	dissemination mode (gossip protocol)
     env_dissemination_mode = atoi(check_and_getenv("DISSEMINATION"));
     fprintf(stdout, "LUNES____[%10d]: DISSEMINATION, dissemination mode -> %d\n", local_pid, env_dissemination_mode);
@@ -563,14 +570,296 @@ void user_environment_handler() {
         exit(-1);
         break;
     }
+}
+
+// Configurations of a sweep (see SWEEP): dissemination mode and the value of its
+//	parameter ("" to keep the one of the environment)
+static unsigned short sweep_mode[MAX_SWEEP];
+static char           sweep_parameter[MAX_SWEEP][32];
+
+/*! \brief Environment variable with the parameter of a dissemination mode ("" if
+ *         the mode has no parameter, NULL if the mode does not exist)
+ */
+static const char *dissemination_parameter(int mode) {
+    switch (mode) {
+    case BROADCAST:
+        return("BROADCAST_PROB_THRESHOLD");
+
+    case GOSSIP_FIXED_PROB:
+        return("FIXED_PROB_THRESHOLD");
+
+    case DANDELION:
+    case DANDELIONPLUS:
+    case DANDELIONPLUSPLUS:
+        return("DANDELION_STEPS_STEM_PHASE");
+
+    case DEGREE_DEPENDENT_GOSSIP:
+        return("FUNCTION_COEFFICIENT");
+
+    case FIXED_FANOUT:
+        return("");
+
+    default:
+        return(NULL);
+    }
+}
+
+/*! \brief Runtime configuration of a sweep: SWEEP is a list of "mode[:parameter]",
+ *         separated by commas (e.g. "0:70,1:50,6:5,4"). The configurations share
+ *         the warm-up of the network, they are forked at its end (see t_graph.c)
+ */
+static void sweep_environment() {
+    char        list[1024], *token, *next, *colon, *end;
+    const char *parameter;
+    long        mode;
+
+    env_sweep = 0;
+    if (getenv("SWEEP") == NULL || getenv("SWEEP")[0] == '\0') {
+        return;
+    }
+    snprintf(list, sizeof(list), "%s", getenv("SWEEP"));
 
+    for (token = strtok_r(list, ",", &next); token != NULL; token = strtok_r(NULL, ",", &next)) {
+        if ((colon = strchr(token, ':')) != NULL) {
+            *colon = '\0';
+        }
+        mode      = strtol(token, &end, 10);
+        parameter = (end != token && *end == '\0') ? dissemination_parameter(mode) : NULL;
+
+        // The parameter is a number, only for the modes that have one
+        if (parameter != NULL && colon != NULL) {
+            strtod(colon + 1, &end);
+            if (parameter[0] == '\0' || end == colon + 1 || *end != '\0' || strlen(colon + 1) >= sizeof(sweep_parameter[0])) {
+                parameter = NULL;
+            }
+        }
+        if (parameter == NULL) {
+            fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, SWEEP configuration %d is not a valid \"mode[:parameter]\"!!!\n", local_pid, env_sweep);
+            fflush(stdout);
+            exit(-1);
+        }
+        if (env_sweep == MAX_SWEEP) {
+            fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, SWEEP has more than %d configurations!!!\n", local_pid, MAX_SWEEP);
+            fflush(stdout);
+            exit(-1);
+        }
+        sweep_mode[env_sweep] = (unsigned short)mode;
+        snprintf(sweep_parameter[env_sweep], sizeof(sweep_parameter[0]), "%s", colon != NULL ? colon + 1 : "");
+        env_sweep++;
+    }
+
+    // The last epoch that begins within the warm-up, the lookups start after it
+    env_sweep_step = WARMUP_STEPS - WARMUP_STEPS % env_max_ttl;
+    fprintf(stdout, "LUNES____[%10d]: SWEEP, %d configurations forked at timestep %d\n", local_pid, env_sweep, env_sweep_step);
+
+    // With a single LP all the model events are local and the configurations can
+    //	advance by themselves, without GAIA
+    if (NLP != 1 || ((env_migration > 0) && (env_migration < 4))) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, SWEEP requires a single LP and no MIGRATION!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+    if ((env_restore > env_sweep_step) || (env_end_clock <= env_sweep_step)) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, SWEEP requires RESTORE <= %d < END_CLOCK!!!\n", local_pid, env_sweep_step);
+        fflush(stdout);
+        exit(-1);
+    }
+}
+
+/*! \brief Runtime configuration of the replicas: REPLICAS runs of the model in a
+ *         single process, THREADS at a time. REPLICA_GRAPHS is the name of the
+ *         topology of each replica, "%d" is replaced by the replica (e.g.
+ *         "graphs/graph-%d.dot"), by default all of them use the same one
+ */
+static void replica_environment() {
+    char *conversion;
+
+    env_replicas = getenv("REPLICAS") ? atoi(getenv("REPLICAS")) : 0;
+    fprintf(stdout, "LUNES____[%10d]: REPLICAS, replicas of the run in this process -> %d\n", local_pid, env_replicas);
+    if (env_replicas <= 0) {
+        env_replicas = 0;
+        return;
+    }
+
+    env_replica_graphs = (getenv("REPLICA_GRAPHS") && getenv("REPLICA_GRAPHS")[0] != '\0') ? getenv("REPLICA_GRAPHS") : NULL;
+    fprintf(stdout, "LUNES____[%10d]: REPLICA_GRAPHS, topology of each replica -> %s\n", local_pid, env_replica_graphs ? env_replica_graphs : "default");
+    if (env_replica_graphs != NULL &&
+        ((conversion = strchr(env_replica_graphs, '%')) == NULL || conversion[1] != 'd' || strchr(conversion + 2, '%') != NULL)) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, REPLICA_GRAPHS has to contain a single \"%%d\"!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+
+    // The replicas have no other LP to talk with: all the model events are local
+    //	and they advance by themselves, without GAIA
+    if (NLP != 1 || ((env_migration > 0) && (env_migration < 4))) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, REPLICAS requires a single LP and no MIGRATION!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+    if (env_checkpoint > 0 || env_restore > 0 || env_sweep > 0) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, REPLICAS is not supported with CHECKPOINT, RESTORE and SWEEP!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+}
+
+/*****************************************************************************
+ *! \brief SWEEP: the LP (or a child of it, see t_graph.c) runs the measurement
+ *         phase with the given configuration of the sweep
+ */
+void user_sweep_handler(context_t *ctx, int configuration) {
+    char mode[16];
+
+    snprintf(mode, sizeof(mode), "%d", sweep_mode[configuration]);
+    setenv("DISSEMINATION", mode, 1);
+    if (sweep_parameter[configuration][0] != '\0') {
+        setenv(dissemination_parameter(sweep_mode[configuration]), sweep_parameter[configuration], 1);
+    }
+
+    fprintf(stdout, "LUNES____[%10d]: SWEEP, configuration %d of %d\n", local_pid, configuration, env_sweep);
+    dissemination_environment();
+    fflush(stdout);
+
+    lunes_user_sweep_handler(ctx, configuration);
+}
+
+void user_environment_handler() {
+    // ######################## RUNTIME CONFIGURATION SECTION ####################################
+    //	Runtime configuration:	migration type configuration
+    env_migration = atoi(check_and_getenv("MIGRATION"));
+    fprintf(stdout, "LUNES____[%10d]: MIGRATION, migration variable set to %d\n", local_pid, env_migration);
+    if ((env_migration > 0) && (env_migration < 4)) {
+        fprintf(stdout, "LUNES____[%10d]: MIGRATION is ON, migration type is set to %d\n", local_pid, env_migration);
+        GAIA_SetMigration(env_migration);
+    }else {
+        fprintf(stdout, "LUNES____[%10d]: MIGRATION is OFF\n", local_pid);
+        GAIA_SetMigration(MIGR_OFF);
+    }
+
+    //	Runtime configuration:	migration factor (GAIA)
+    env_migration_factor = atof(check_and_getenv("MFACTOR"));
+    fprintf(stdout, "LUNES____[%10d]: MFACTOR, migration factor: %f\n", local_pid, env_migration_factor);
+    GAIA_SetMF(env_migration_factor);
+
+    //	Runtime configuration:	turning on/off the load balancing (GAIA)
+    env_load = atoi(check_and_getenv("LOAD"));
+    fprintf(stdout, "LUNES____[%10d]: LOAD, load balancing: %d\n", local_pid, env_load);
+    if (env_load == 1) {
+        fprintf(stdout, "LUNES____[%10d]: LOAD, load balancing is ON\n", local_pid);
+        GAIA_SetLoadBalancing(LOAD_ON);
+    }else {
+        fprintf(stdout, "LUNES____[%10d]: LOAD, load balancing is OFF\n", local_pid);
+        GAIA_SetLoadBalancing(LOAD_OFF);
+    }
+
+    //	Runtime configuration:	number of steps in the simulation run
+    env_end_clock = atof(check_and_getenv("END_CLOCK"));
+    fprintf(stdout, "LUNES____[%10d]: END_CLOCK, number of steps in the simulation run -> %f\n", local_pid, env_end_clock);
+    if (env_end_clock == 0) {
+        fprintf(stdout, "LUNES____[%10d]:  END_CLOCK is 0, no timesteps are defined for this run!!!\n", local_pid);
+    }
+
+    //	Runtime configuration:	worker threads of the LP (optional, default 1)
+    env_threads = getenv("THREADS") ? atoi(getenv("THREADS")) : 1;
+    fprintf(stdout, "LUNES____[%10d]: THREADS, worker threads -> %d\n", local_pid, env_threads);
+    if (env_threads < 1) {
+        fprintf(stdout, "LUNES____[%10d]: THREADS is < 1, using a single thread\n", local_pid);
+        env_threads = 1;
+    }
+
+    //	Runtime configuration:	concurrent lookups in each epoch (optional, default 1)
+    env_lookups = getenv("LOOKUPS") ? atoi(getenv("LOOKUPS")) : 1;
+    fprintf(stdout, "LUNES____[%10d]: LOOKUPS, concurrent lookups in each epoch -> %d\n", local_pid, env_lookups);
+    if ((env_lookups < 1) || (env_lookups > MAX_LOOKUPS)) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, LOOKUPS is out of the boundaries [1, %d]!!!\n", local_pid, MAX_LOOKUPS);
+        fflush(stdout);
+        exit(-1);
+    }
+
+    //	Runtime configuration:	messages remembered by each node (optional), the duplicates
+    //	are dropped only while they are in the cache
+    env_cache_size = getenv("CACHE_SIZE") ? atoi(getenv("CACHE_SIZE")) : CACHE_SIZE;
+    fprintf(stdout, "LUNES____[%10d]: CACHE_SIZE, messages in the cache of each node -> %u\n", local_pid, env_cache_size);
+    if ((env_cache_size < 1) || (env_cache_size > 65535)) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, CACHE_SIZE is out of the boundaries [1, 65535]!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+    if (env_cache_size < (unsigned int)env_lookups) {
+        fprintf(stdout, "LUNES____[%10d]: CACHE_SIZE is smaller than LOOKUPS, some duplicates will be forwarded again\n", local_pid);
+    }
+
+    //	Runtime configuration:	the links of the topology are built by each LP for its own SEs,
+    //	instead of sending a link message for each edge (optional, default 0)
+    env_bulk_links = getenv("BULK_LINKS") ? atoi(getenv("BULK_LINKS")) : 0;
+    fprintf(stdout, "LUNES____[%10d]: BULK_LINKS, local construction of the topology -> %s\n", local_pid, env_bulk_links ? "ON" : "OFF");
+
+    env_perc_active_nodes_ = atof(check_and_getenv("ACTIVE_PERC"));
+    fprintf(stdout, "LUNES____[%10d]: ACTIVE_PERC, initial percentage of active nodes -> %d\n", local_pid, env_perc_active_nodes_);
+    if (env_perc_active_nodes_ <= 0) {
+        fprintf(stdout, "LUNES____[%10d]: ACTIVE_PERC is <= 0, error \n", local_pid);
+    }
+
+    //	Runtime configuration:	time-to-live for new messages in the network
+    env_max_ttl = atoi(check_and_getenv("MAX_TTL"));
+    fprintf(stdout, "LUNES____[%10d]: MAX_TTL, maximum time-to-live for messages in the network -> %d\n", local_pid, env_max_ttl);
+
+    if (env_max_ttl == 0) {
+        fprintf(stdout, "LUNES____[%10d]: MAX_TTL is 0, no TTL is defined for this run!\n", local_pid);
+    }
+
+    //	Runtime configuration:	a checkpoint of the LP every CHECKPOINT epochs (optional, default 0: none)
+    env_checkpoint = getenv("CHECKPOINT") ? atoi(getenv("CHECKPOINT")) : 0;
+    fprintf(stdout, "LUNES____[%10d]: CHECKPOINT, epochs between two checkpoints -> %d\n", local_pid, env_checkpoint);
+
+    //	Runtime configuration:	the run is resumed from the checkpoint of the given timestep
+    //	(optional, default 0: from the beginning), the timesteps before it are skipped
+    env_restore = getenv("RESTORE") ? atoi(getenv("RESTORE")) : 0;
+    fprintf(stdout, "LUNES____[%10d]: RESTORE, timestep of the checkpoint to resume from -> %d\n", local_pid, env_restore);
+    if ((env_restore < 0) || (env_restore > 0 && (env_max_ttl == 0 || env_restore % env_max_ttl != 0 || env_restore >= env_end_clock))) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, RESTORE is not the beginning of an epoch before END_CLOCK!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+    if ((env_checkpoint > 0 || env_restore > 0) && (env_migration > 0) && (env_migration < 4)) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, CHECKPOINT and RESTORE are not supported with MIGRATION!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+
+
+    //	Runtime configuration:	a record of metrics for each epoch, in the METRICS_*.dat
+    //	files (optional, default 0: none), see metrics.h for the format
+    env_metrics = getenv("METRICS") ? atoi(getenv("METRICS")) : 0;
+    fprintf(stdout, "LUNES____[%10d]: METRICS, per-epoch metrics stream -> %s\n", local_pid, env_metrics ? "ON" : "OFF");
+
+    //	Runtime configuration:	report of the wall-clock time spent in each phase of the LP
+    //	every PROFILE timesteps, with a summary at the end (optional, default 0: off)
+    env_profile = getenv("PROFILE") ? atoi(getenv("PROFILE")) : 0;
+    fprintf(stdout, "LUNES____[%10d]: PROFILE, timesteps between two profiler reports -> %d\n", local_pid, env_profile);
+    if (env_profile < 0) {
+        fprintf(stdout, "LUNES____[%10d]: FATAL ERROR, PROFILE cannot be negative!!!\n", local_pid);
+        fflush(stdout);
+        exit(-1);
+    }
+
+    //	Runtime configuration:	dissemination mode and its parameters
+    dissemination_environment();
+
+    //	Runtime configuration:	configurations of a sweep, "mode[:parameter],..." (optional), see user_sweep_handler()
+    sweep_environment();
+
+    //	Runtime configuration:	replicas of the run executed by this process (optional, default 0: none),
+    //	each one with its own seed and optionally its own topology (see t_graph.c)
+    replica_environment();
 }
 
 /*****************************************************************************
  *! \brief BOOTSTRAP: before starting the real simulation tasks, the model level
  *         can initialize some data structures and set parameters
  */
-void user_bootstrap_handler() {
+void user_bootstrap_handler(context_t *ctx) {
     #ifdef TRACE_DISSEMINATION
     char buffer[1024];
 
@@ -579,13 +868,35 @@ void user_bootstrap_handler() {
 
     fp_print_trace = fopen(buffer, "w");
     #endif
+
+    lunes_user_bootstrap_handler(ctx);
+}
+
+/*****************************************************************************
+ *! \brief STATISTICS: at the end of the run, the statistics collected by each
+ *         worker are summed up (and the model level ones are printed in "out")
+ */
+void user_statistics_handler(context_t *ctx, FILE *out) {
+    lunes_user_statistics_handler(ctx, out);
+}
+
+/*****************************************************************************
+ *! \brief CHECKPOINT: the model level state of the LP is appended to a
+ *         checkpoint (see t_graph.c), or read back when the run is resumed
+ */
+void user_checkpoint_save_handler(context_t *ctx, checkpoint_t *ck) {
+    lunes_user_checkpoint_save_handler(ctx, ck);
+}
+
+void user_checkpoint_restore_handler(context_t *ctx, checkpoint_t *ck) {
+    lunes_user_checkpoint_restore_handler(ctx, ck);
 }
 
 /*****************************************************************************
  *! \brief SHUTDOWN: Before shutting down, the model layer is able to
  *         deallocate some data structures
  */
-void user_shutdown_handler() {
+void user_shutdown_handler(context_t *ctx) {
     #ifdef TRACE_DISSEMINATION
     char  buffer[1024];
     FILE *fp_print_messages_trace;
@@ -605,4 +916,6 @@ void user_shutdown_handler() {
 
     fclose(fp_print_trace);
     #endif
+
+    lunes_user_shutdown_handler(ctx);
 }
\ No newline at end of file
@@ -15,6 +15,8 @@
 #define __USER_EVENT_HANDLERS_H
 
 #include "msg_definition.h"
+#include "checkpoint.h"
+#include "context.h"
 #include <rnd.h>
 
 
@@ -23,32 +25,36 @@
 /* ************************************************************************ */
 
 //	Event handlers
-void user_register_event_handler(hash_node_t *, int);
-void user_notify_migration_event_handler();
-void user_notify_ext_migration_event_handler();
-void user_migration_event_handler(hash_node_t *, int, Msg *);
-void user_model_events_handler(int, int, Msg *, hash_node_t *);
-void user_request_event_handler(hash_node_t *, int, Msg *);
-void user_link_event_handler(hash_node_t *, int);
-void user_unlink_event_handler(hash_node_t *, int);
+void user_register_event_handler(context_t *, hash_node_t *, int);
+void user_notify_migration_event_handler(context_t *);
+void user_notify_ext_migration_event_handler(context_t *);
+void user_migration_event_handler(context_t *, hash_node_t *, int, MigrMsg *);
+void user_model_events_handler(context_t *, int, int, Msg *, hash_node_t *);
+int  user_model_events_phase(Msg *);
+void user_request_event_handler(context_t *, hash_node_t *, int, Msg *);
+void user_link_event_handler(context_t *, hash_node_t *, int);
+void user_unlink_event_handler(context_t *, hash_node_t *, int);
 
 //	Other handlers
-void user_control_handler();
-void user_bootstrap_handler();
+void user_control_handler(context_t *);
+void user_bootstrap_handler(context_t *);
 void user_environment_handler();
-void user_shutdown_handler();
+void user_statistics_handler(context_t *, FILE *);
+void user_sweep_handler(context_t *, int);
+void user_checkpoint_save_handler(context_t *, checkpoint_t *);
+void user_checkpoint_restore_handler(context_t *, checkpoint_t *);
+void user_shutdown_handler(context_t *);
 
 /* ************************************************************************ */
 /*      S U P P O R T     F U N C T I O N S			                        */
 /* ************************************************************************ */
 
-int add_entity_state_entry(unsigned int, value_element *, int, hash_node_t *);
-int delete_entity_state_entry(unsigned int, hash_node_t *);
-int modify_entity_state_entry(unsigned int, unsigned int, hash_node_t *);
-void execute_link(double, hash_node_t *, hash_node_t *);
-void execute_unlink(double, hash_node_t *, hash_node_t *);
-void execute_request(double, hash_node_t *, hash_node_t *, unsigned short, int, float, unsigned int);
+int add_entity_state_entry(context_t *, unsigned int, value_element *, int, hash_node_t *);
+int delete_entity_state_entry(context_t *, unsigned int, hash_node_t *);
+int modify_entity_state_entry(context_t *, unsigned int, unsigned int, hash_node_t *);
+void execute_link(context_t *, double, hash_node_t *, hash_node_t *);
+void execute_unlink(context_t *, double, hash_node_t *, hash_node_t *);
+void execute_request(context_t *, double, hash_node_t *, hash_node_t *, unsigned short, int, float, unsigned int);
 char *check_and_getenv(char *);
-gpointer hash_table_random_key(GHashTable *);
 
 #endif /* __USER_EVENT_HANDLERS_H */
@@ -40,69 +40,111 @@ extern int    *attackers;
 /*           D A T A    S T R U C T U R E S    M A N A G E M E N T           */
 /* ************************************************************************* */
 
-/*! \brief Custom hash generation function */
-int hash(hash_t *tptr, int x) {
-    return(x % tptr->size);
+/*! \brief Hash table initialization: the whole directory is allocated in
+ *         a single step, no further allocations are needed for the GSE
+ *
+ *  @param[in] size: number of nodes (GSE: all the SEs, LSE: initial number of local slots)
+ *  @param[in] keys: range of the identifiers (the total number of SEs)
+ */
+void hash_init(enum HASH_TYPE type, hash_t *tptr, int size, int keys) {
+    int i;
+
+    tptr->type  = type;
+    tptr->size  = size;
+    tptr->keys  = keys;
+    tptr->count = 0;
+    tptr->data  = NULL;
+    tptr->slot  = NULL;
+    tptr->node  = (hash_node_t *)calloc(tptr->size, sizeof(hash_node_t));
+    ASSERT((tptr->node != NULL), ("hash_init: malloc error"));
+
+    tptr->status        = NULL;
+    tptr->num_neighbors = NULL;
+
+    if (type == GSE) {
+        tptr->data = (struct hash_data_t *)calloc(tptr->size, sizeof(hash_data_t));
+        ASSERT((tptr->data != NULL), ("hash_init: malloc error"));
+
+        tptr->status        = (unsigned char *)calloc(tptr->size, sizeof(unsigned char));
+        tptr->num_neighbors = (unsigned short *)calloc(tptr->size, sizeof(unsigned short));
+        ASSERT((tptr->status != NULL && tptr->num_neighbors != NULL), ("hash_init: malloc error"));
+    }else {
+        tptr->slot = (int *)malloc(tptr->keys * sizeof(int));
+        ASSERT((tptr->slot != NULL), ("hash_init: malloc error"));
+
+        for (i = 0; i < tptr->keys; i++) {
+            tptr->slot[i] = -1;
+        }
+    }
+    return;
 }
 
-/*! \brief Hash table initialization
+/*! \brief Releases a hash table (the states of the SEs belong to the GSE)
  */
-void hash_init(hash_t *tptr, int size) {
-    tptr->size   = size;
-    tptr->count  = 0;
-    tptr->bucket = (hash_node_t **)calloc(tptr->size, sizeof(hash_node_t *));
-    return;
+void hash_free(hash_t *tptr) {
+    free(tptr->node);
+    free(tptr->data);
+    free(tptr->slot);
+    free(tptr->status);
+    free(tptr->num_neighbors);
+
+    tptr->node          = NULL;
+    tptr->data          = NULL;
+    tptr->slot          = NULL;
+    tptr->status        = NULL;
+    tptr->num_neighbors = NULL;
+    tptr->count         = 0;
 }
 
 /*! \brief Lookup of a simulated entity (hash table)
  */
 hash_node_t *hash_lookup(hash_t *tptr, int key) {
-    int          h;
-    hash_node_t *node;
+    if ((key < 0) || (key >= tptr->keys)) {
+        return(NULL);
+    }
 
-    h = hash(tptr, key);
-    for (node = tptr->bucket[h]; node != NULL; node = node->next) {
-        if (node->data->key == key) {
-            break;
-        }
+    if (tptr->type == GSE) {
+        return(tptr->node[key].data ? &tptr->node[key] : NULL);
     }
 
-    return(node);
+    return(tptr->slot[key] != -1 ? &tptr->node[tptr->slot[key]] : NULL);
 }
 
 /*! \brief Insertion of a new simulated entity (hash table)
  */
 hash_node_t *hash_insert(enum HASH_TYPE type, hash_t *tptr, struct hash_data_t *data, int key, int lp) {
     hash_node_t *node, *tmp;
-    int          h;
-    // Make global
 
     if ((tmp = hash_lookup(tptr, key))) {
         return(tmp);
     }
 
-    h    = hash(tptr, key);
-    node = (struct hash_node_t *)malloc(sizeof(hash_node_t));
-    ASSERT((node != NULL), ("hash_insert: malloc error"));
+    ASSERT(((key >= 0) && (key < tptr->keys)), ("hash_insert: identifier %d out of range", key));
 
     // Inserting the SE in the global hashtable
     if (type == GSE) {
-        node->data = (struct hash_data_t *)malloc(sizeof(hash_data_t));
-        ASSERT((node->data != NULL), ("hash_insert: malloc error"));
+        node       = &tptr->node[key];
+        node->data = &tptr->data[key];
         node->data->key = key;
+        tptr->status[key] = 1;
     } // Inserting the SE in the local hashtable
-    else if (type == LSE) {
-        node->data = data;
+    else {
+        // More local slots are needed (i.e. migrations towards this LP)
+        if (tptr->count == tptr->size) {
+            tptr->size *= 2;
+            tptr->node  = (hash_node_t *)realloc(tptr->node, tptr->size * sizeof(hash_node_t));
+            ASSERT((tptr->node != NULL), ("hash_insert: malloc error"));
+        }
+        node            = &tptr->node[tptr->count];
+        node->data      = data;
+        tptr->slot[key] = tptr->count;
     }
     node->data->lp = lp;
-    node->data->status = 1;
 
     // Init some values
     node->data->internal_timer = 0;
 
-    node->next      = tptr->bucket[h];
-    tptr->bucket[h] = node;
-    tptr->count    += 1;
+    tptr->count += 1;
 
     return(node);
 }
@@ -110,39 +152,122 @@ hash_node_t *hash_insert(enum HASH_TYPE type, hash_t *tptr, struct hash_data_t *
 /*! \brief Deletion of a node (hash table)
  */
 int UNUSED hash_delete(enum HASH_TYPE type, hash_t *tptr, int key) {
-    hash_node_t *node, *last;
-    int          h;
-
-    h = hash(tptr, key);
-    for (node = tptr->bucket[h]; node; node = node->next) {
-        if (node->data->key == key) {
-            break;
-        }
-    }
+    hash_node_t *node;
+    int          last;
 
-    if (node == NULL) {
+    if (!(node = hash_lookup(tptr, key))) {
         return(-1);
     }
 
-    if (node == tptr->bucket[h]) {
-        tptr->bucket[h] = node->next;
+    if (type == GSE) {
+        node->data = NULL;
     }else {
-        for (last = tptr->bucket[h]; last && last->next; last = last->next) {
-            if (last->next == node) {
-                break;
-            }
+        // The last local slot takes the place of the deleted one
+        last = tptr->count - 1;
+        if (tptr->slot[key] != last) {
+            *node = tptr->node[last];
+            tptr->slot[node->data->key] = tptr->slot[key];
         }
-        last->next = node->next;
+        tptr->slot[key] = -1;
     }
 
     tptr->count -= 1;
+    return(1);
+}
 
-    if (type == GSE) {
-        free(node->data);
+/*! \brief Calendar queue of per-SE events: bucket i holds the events of the
+ *         timesteps i, i + size, i + 2 * size ... Only the current bucket is
+ *         scanned at each step, the events of the following laps stay in it
+ */
+void calendar_init(calendar_t *cal, int size) {
+    int i;
+
+    cal->bucket = (GArray **)malloc(sizeof(GArray *) * size);
+    ASSERT((cal->bucket != NULL), ("calendar_init: malloc error"));
+
+    for (i = 0; i < size; i++) {
+        cal->bucket[i] = g_array_new(FALSE, FALSE, sizeof(calendar_event));
     }
+    cal->size  = size;
+    cal->count = 0;
+}
 
-    free(node);
-    return(1);
+/*! \brief Schedules an event of the SE "key" at the given timestep
+ */
+void calendar_insert(calendar_t *cal, int step, int key) {
+    calendar_event event;
+
+    event.step = step;
+    event.key  = key;
+    g_array_append_val(cal->bucket[step % cal->size], event);
+    cal->count++;
+}
+
+static gint calendar_compare(gconstpointer a, gconstpointer b) {
+    return(*(const int *)a - *(const int *)b);
+}
+
+/*! \brief Moves the IDs of the SEs with an event at the given timestep
+ *         in "due" (sorted, the order does not depend on the insertions)
+ *         and returns how many they are
+ */
+int calendar_pop(calendar_t *cal, int step, GArray *due) {
+    GArray *        bucket = cal->bucket[step % cal->size];
+    calendar_event *event;
+    guint           i = 0;
+    int             found = 0;
+
+    g_array_set_size(due, 0);
+    while (i < bucket->len) {
+        event = &g_array_index(bucket, calendar_event, i);
+        if (event->step <= step) {
+            g_array_append_val(due, event->key);
+            g_array_remove_index_fast(bucket, i);
+            found++;
+        } else {
+            i++;
+        }
+    }
+    cal->count -= found;
+    g_array_sort(due, calendar_compare);
+
+    return(found);
+}
+
+/*! \brief Removes the events of the SE "key" (all the buckets are scanned),
+ *         returns how many they were
+ */
+int calendar_remove(calendar_t *cal, int key) {
+    guint i;
+    int   h, found = 0;
+
+    for (h = 0; h < cal->size; h++) {
+        for (i = 0; i < cal->bucket[h]->len; ) {
+            if (g_array_index(cal->bucket[h], calendar_event, i).key == key) {
+                g_array_remove_index_fast(cal->bucket[h], i);
+                found++;
+            } else {
+                i++;
+            }
+        }
+    }
+    cal->count -= found;
+
+    return(found);
+}
+
+/*! \brief Releases the calendar and all its events
+ */
+void calendar_free(calendar_t *cal) {
+    int i;
+
+    for (i = 0; i < cal->size; i++) {
+        g_array_free(cal->bucket[i], TRUE);
+    }
+    free(cal->bucket);
+    cal->bucket = NULL;
+    cal->size   = 0;
+    cal->count  = 0;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -200,3 +325,183 @@ struct hash_node_t *list_del(se_list *list) {
 }
 
 /*---------------------------------------------------------------------------*/
+
+/* ************************************************************************* */
+/*           A D J A C E N C Y    M A N A G E M E N T    ( C S R )           */
+/* ************************************************************************* */
+
+/*! \brief CSR snapshot initialization
+ */
+void csr_init(csr_t *csr) {
+    csr->block    = NULL;
+    csr->size     = 0;
+    csr->overlays = 0;
+}
+
+/*! \brief Packs the rows of all the local SEs in a new contiguous block,
+ *         the private overlays created since the last fold are released
+ */
+void csr_fold(csr_t *csr, hash_t *tptr) {
+    struct state_element *block, *cursor;
+    adj_row *             row;
+    unsigned int          size = 0;
+    int                   h;
+
+    // Nothing has changed since the last fold
+    if ((csr->block != NULL) && (csr->overlays == 0)) {
+        return;
+    }
+
+    for (h = 0; h < tptr->count; h++) {
+        size += tptr->node[h].data->neighbors.count;
+    }
+
+    block = (struct state_element *)malloc((size > 0 ? size : 1) * sizeof(struct state_element));
+    ASSERT((block != NULL), ("csr_fold: malloc error"));
+
+    // Rows are copied in the order of the local slots, both from the
+    // previous snapshot and from the overlays
+    cursor = block;
+    for (h = 0; h < tptr->count; h++) {
+        row = &tptr->node[h].data->neighbors;
+        if (row->count > 0) {
+            memcpy(cursor, row->record, row->count * sizeof(struct state_element));
+        }
+        if (row->overlay) {
+            free(row->record);
+        }
+        row->record   = cursor;
+        row->capacity = row->count;
+        row->overlay  = 0;
+        cursor       += row->count;
+    }
+
+    free(csr->block);
+    csr->block    = block;
+    csr->size     = size;
+    csr->overlays = 0;
+}
+
+/*! \brief Releases the snapshot and the rows of all the local SEs
+ */
+void csr_free(csr_t *csr, hash_t *tptr) {
+    int h;
+
+    for (h = 0; h < tptr->count; h++) {
+        adj_row_free(&tptr->node[h].data->neighbors);
+    }
+    free(csr->block);
+    csr_init(csr);
+}
+
+/*! \brief Empty row initialization
+ */
+void adj_row_init(adj_row *row) {
+    row->record   = NULL;
+    row->count    = 0;
+    row->capacity = 0;
+    row->overlay  = 0;
+    row->index    = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+/*! \brief Moves a row in its private overlay (if it is still in the snapshot)
+ *         and makes room for at least one more record
+ */
+static void adj_row_reserve(csr_t *csr, adj_row *row) {
+    struct state_element *record;
+    unsigned int          capacity;
+
+    if (row->overlay && (row->count < row->capacity)) {
+        return;
+    }
+
+    capacity = (row->count < 2) ? 4 : 2 * row->count;
+    record   = (struct state_element *)malloc(capacity * sizeof(struct state_element));
+    ASSERT((record != NULL), ("adj_row_reserve: malloc error"));
+
+    if (row->count > 0) {
+        memcpy(record, row->record, row->count * sizeof(struct state_element));
+    }
+
+    if (row->overlay) {
+        free(row->record);
+    }else {
+        g_atomic_int_inc(&csr->overlays);           // Rows of different SEs can be updated by different workers
+    }
+
+    row->record   = record;
+    row->capacity = capacity;
+    row->overlay  = 1;
+}
+
+/*! \brief Position of a neighbor in the row, -1 if it is not present
+ */
+int adj_row_find(adj_row *row, unsigned int key) {
+    return((int)GPOINTER_TO_UINT(g_hash_table_lookup(row->index, GUINT_TO_POINTER(key))) - 1);
+}
+
+/*! \brief Position of a neighbor chosen uniformly at random, -1 if the row is empty
+ *  @param[in] rnd: 32 random bits (see rng.h)
+ */
+int adj_row_random(adj_row *row, unsigned int rnd) {
+    if (row->count == 0) {
+        return(-1);
+    }
+    return((int)(((unsigned long long)rnd * row->count) >> 32));
+}
+
+/*! \brief Appends a new neighbor to the row
+ *         NOTE: no duplicated keys are allowed
+ */
+int adj_row_insert(csr_t *csr, adj_row *row, unsigned int key, value_element *val) {
+    if (adj_row_find(row, key) != -1) {
+        return(-1);
+    }
+
+    adj_row_reserve(csr, row);
+    row->record[row->count].key      = key;
+    row->record[row->count].elements = *val;
+    row->count                      += 1;
+    g_hash_table_insert(row->index, GUINT_TO_POINTER(key), GUINT_TO_POINTER(row->count));
+
+    return(1);
+}
+
+/*! \brief Removes a neighbor from the row, the last record takes its place
+ */
+int adj_row_delete(csr_t *csr, adj_row *row, unsigned int key) {
+    int position;
+
+    if ((position = adj_row_find(row, key)) == -1) {
+        return(-1);
+    }
+
+    adj_row_reserve(csr, row);
+    row->count           -= 1;
+    row->record[position] = row->record[row->count];
+    g_hash_table_remove(row->index, GUINT_TO_POINTER(key));
+
+    // The last record (if it was not the deleted one) has been moved
+    if ((unsigned int)position < row->count) {
+        g_hash_table_insert(row->index, GUINT_TO_POINTER(row->record[position].key), GUINT_TO_POINTER(position + 1));
+    }
+
+    return(0);
+}
+
+/*! \brief Releases the row (e.g. when the SE is migrated)
+ */
+void adj_row_free(adj_row *row) {
+    if (row->overlay) {
+        free(row->record);
+    }
+    g_hash_table_destroy(row->index);
+
+    row->record   = NULL;
+    row->count    = 0;
+    row->capacity = 0;
+    row->overlay  = 0;
+    row->index    = NULL;
+}
+
+/*---------------------------------------------------------------------------*/
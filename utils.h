@@ -45,15 +45,36 @@ enum HASH_TYPE {
 
 typedef struct hash_node_t {
     struct hash_data_t *data;
-    struct hash_node_t *next;
 } hash_node_t;
 
+/*! \brief Directory of simulated entities, the identifiers are contiguous so
+ *         it is a dense array indexed by ID (GSE). The table of the local
+ *         entities (LSE) packs them in slots, reached through the ID -> slot
+ *         indirection, so that they can migrate in and out of the LP
+ */
 typedef struct hash_t {
-    struct hash_node_t **bucket;
-    int                  count;
-    int                  size;
+    enum HASH_TYPE       type;
+    struct hash_node_t  *node;          // Nodes: indexed by ID (GSE) or by local slot (LSE)
+    struct hash_data_t  *data;          // States of all the SEs, indexed by ID (GSE only)
+    int                 *slot;          // ID -> local slot, -1 if the SE is not local (LSE only)
+    int                  keys;          // Range of the identifiers: 0 .. keys - 1
+    int                  count;         // Number of inserted SEs
+    int                  size;          // Number of allocated nodes
+
+    // Hot fields of the SEs, struct-of-arrays indexed by ID (GSE only)
+    unsigned char       *status;        // 0 off 1 active (the progress in the lookups is kept by the model, see lunes.c)
+    unsigned short      *num_neighbors; // Number of SE's neighbors (dynamically updated)
 } hash_t;
 
+//	Access to the hot fields of a SE in the global directory of a context, see hash_t
+#define SE_STATUS(_ctx, _node)           ((_ctx)->table->status[(_node)->data->key])
+#define SE_NUM_NEIGHBORS(_ctx, _node)    ((_ctx)->table->num_neighbors[(_node)->data->key])
+
+//	The number of neighbors is bounded by the size of the migration messages
+#if MAX_MIGRATION_DYNAMIC_RECORDS >= 65535
+#error "MAX_MIGRATION_DYNAMIC_RECORDS is too large for the num_neighbors field of hash_t"
+#endif
+
 /* ************************************************************************ */
 /*                      Lists		                                        */
 /* ************************************************************************ */
@@ -68,11 +89,34 @@ typedef struct se_list {
     int               size;
 } se_list;
 
+/* ************************************************************************ */
+/*                      Adjacency (CSR)	                                    */
+/* ************************************************************************ */
+typedef struct csr_t {
+    struct state_element *block;    // Rows of all the local SEs, packed one after the other
+    unsigned int          size;     // Number of records in the block
+    volatile gint         overlays; // Rows moved in a private overlay since the last fold
+} csr_t;
+
+/* ************************************************************************ */
+/*                      Calendar queue	                                    */
+/* ************************************************************************ */
+typedef struct calendar_event {
+    int step;                       // Timestep of the event
+    int key;                        // ID of the SE
+} calendar_event;
+
+typedef struct calendar_t {
+    GArray **bucket;                // Ring of buckets, one for each timestep of a lap
+    int      size;                  // Number of buckets (timesteps covered by a lap)
+    int      count;                 // Number of scheduled events
+} calendar_t;
+
 /* ************************************************************************ */
 /*                      Prototypes		                                    */
 /* ************************************************************************ */
-int  hash(hash_t *, int);
-void hash_init(hash_t *, int);
+void hash_init(enum HASH_TYPE, hash_t *, int, int);
+void hash_free(hash_t *);
 int  hash_delete(enum HASH_TYPE, hash_t *, int);
 void list_init(se_list *);
 void list_add(se_list *, hash_node_t *);
@@ -81,4 +125,20 @@ hash_node_t *hash_insert(enum HASH_TYPE, hash_t *, struct hash_data_t *, int, in
 
 struct hash_node_t *list_del(se_list *);
 
+void csr_init(csr_t *);
+void csr_fold(csr_t *, hash_t *);
+void csr_free(csr_t *, hash_t *);
+void adj_row_init(adj_row *);
+int  adj_row_find(adj_row *, unsigned int);
+int  adj_row_random(adj_row *, unsigned int);
+int  adj_row_insert(csr_t *, adj_row *, unsigned int, value_element *);
+int  adj_row_delete(csr_t *, adj_row *, unsigned int);
+void adj_row_free(adj_row *);
+
+void calendar_init(calendar_t *, int);
+void calendar_insert(calendar_t *, int, int);
+int  calendar_pop(calendar_t *, int, GArray *);
+int  calendar_remove(calendar_t *, int);
+void calendar_free(calendar_t *);
+
 #endif /* __UTILS_H */